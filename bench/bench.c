@@ -0,0 +1,299 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "command.h"
+#include "database.h"
+#include "generator.h"
+
+#define DEFAULT_SIZES "1000,10000,100000"
+#define DEFAULT_ITERATIONS 100
+#define MAX_SIZES 16
+#define MAX_ARGS 8
+
+/*
+ * One command path to time. "{id}" in an argument is replaced by the task
+ * the iteration should act on.
+ * */
+typedef struct {
+  const char* name;
+  const char* args[MAX_ARGS];
+} BenchCase;
+
+/*
+ * Cases run in this order on each database. del comes last and walks down
+ * from the highest id, so every iteration deletes an existing task.
+ * */
+static const BenchCase cases[] = {
+    {"list", {"list"}},
+    {"list_pending_page", {"list", "--pending", "--limit", "50"}},
+    {"list_after_page", {"list", "--after", "{id}", "--limit", "50"}},
+    {"search", {"search", "deploy*", "--limit", "20"}},
+    {"add", {"add", "Benchmark task"}},
+    {"check", {"check", "{id}"}},
+    {"uncheck", {"uncheck", "{id}"}},
+    {"del", {"del", "{id}"}},
+};
+
+static const size_t cases_count = sizeof(cases) / sizeof(BenchCase);
+
+typedef struct {
+  size_t sizes[MAX_SIZES];
+  size_t sizes_count;
+  size_t iterations;
+  const char* directory;
+} BenchOptions;
+
+static double now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static long peak_rss_kib() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double left = *(const double*)a;
+  double right = *(const double*)b;
+  return (left > right) - (left < right);
+}
+
+static double percentile(const double* sorted, size_t count, double p) {
+  size_t index = (size_t)(p * (count - 1) + 0.5);
+  return sorted[index];
+}
+
+static bool parse_size(const char* text, size_t* value) {
+  char* end;
+
+  errno = 0;
+  unsigned long long parsed = strtoull(text, &end, 10);
+
+  if (errno || end == text || *end != '\0' || parsed == 0) return false;
+
+  *value = parsed;
+  return true;
+}
+
+static bool parse_sizes(const char* text, BenchOptions* options) {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), "%s", text);
+
+  options->sizes_count = 0;
+
+  for (char* token = strtok(buffer, ","); token; token = strtok(NULL, ",")) {
+    if (options->sizes_count == MAX_SIZES ||
+        !parse_size(token, &options->sizes[options->sizes_count]))
+      return false;
+
+    ++options->sizes_count;
+  }
+
+  return options->sizes_count > 0;
+}
+
+static void remove_database() {
+  unlink("foo.db");
+  unlink("foo.db-wal");
+  unlink("foo.db-shm");
+  unlink("foo.db-journal");
+}
+
+/*
+ * Fills a fresh foo.db in the working directory with the default generated
+ * dataset, so every run and every size share one distribution.
+ * */
+static bool populate(size_t tasks) {
+  GeneratorOptions options = {.count = tasks,
+                              .seed = GEN_DEFAULT_SEED,
+                              .done_percent = GEN_DEFAULT_DONE_PERCENT,
+                              .days = GEN_DEFAULT_DAYS};
+  int first_id, last_id;
+
+  remove_database();
+
+  if (generate_tasks(&options, &first_id, &last_id) != DB_OK) return false;
+
+  return db_close() == DB_OK;
+}
+
+static int task_for_iteration(const BenchCase* bench, size_t tasks,
+                              size_t iteration) {
+  if (strcmp(bench->name, "del") == 0) return tasks - iteration;
+  return 1 + (iteration * 7919) % tasks;
+}
+
+/*
+ * Runs one case iterations times, each as a full command invocation: the
+ * connection is opened by the command and closed afterwards, like main does.
+ * Command output goes to /dev/null.
+ * */
+static bool run_case(const BenchCase* bench, size_t tasks, size_t iterations,
+                     double* samples) {
+  const char* argv[MAX_ARGS + 1] = {"foo"};
+  char id[16];
+  int argc = 1;
+
+  for (; argc <= MAX_ARGS && bench->args[argc - 1]; ++argc) {
+    const char* arg = bench->args[argc - 1];
+    argv[argc] = strcmp(arg, "{id}") == 0 ? id : arg;
+  }
+
+  int null_fd = open("/dev/null", O_WRONLY);
+  int stdout_fd = dup(STDOUT_FILENO);
+
+  if (null_fd < 0 || stdout_fd < 0) {
+    fprintf(stderr, "Failed to redirect command output.\n");
+    return false;
+  }
+
+  bool ok = true;
+
+  fflush(stdout);
+  dup2(null_fd, STDOUT_FILENO);
+
+  for (size_t i = 0; i < iterations && ok; ++i) {
+    snprintf(id, sizeof(id), "%d", task_for_iteration(bench, tasks, i));
+
+    double start = now_us();
+    ok = run_command(argc, argv) == COMM_OK && db_close() == DB_OK;
+    samples[i] = now_us() - start;
+  }
+
+  fflush(stdout);
+  dup2(stdout_fd, STDOUT_FILENO);
+  close(stdout_fd);
+  close(null_fd);
+
+  if (!ok) fprintf(stderr, "Benchmark '%s' failed.\n", bench->name);
+
+  return ok;
+}
+
+static void report(const BenchCase* bench, size_t tasks, size_t iterations,
+                   double* samples, bool first) {
+  double total = 0;
+
+  for (size_t i = 0; i < iterations; ++i) total += samples[i];
+
+  qsort(samples, iterations, sizeof(double), compare_doubles);
+
+  printf("%s\n    {\"tasks\": %zu, \"command\": \"%s\", \"iterations\": %zu, "
+         "\"p50_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f, "
+         "\"ops_per_sec\": %.1f, \"peak_rss_kib\": %ld}",
+         first ? "" : ",", tasks, bench->name, iterations,
+         percentile(samples, iterations, 0.50),
+         percentile(samples, iterations, 0.99), samples[iterations - 1],
+         total > 0 ? iterations / (total / 1e6) : 0, peak_rss_kib());
+}
+
+static void usage() {
+  fprintf(stderr,
+          "Usage: foo_bench [--sizes <n,n,...>] [--iterations <n>] "
+          "[--dir <path>]\n"
+          "Creates a database of each size in a scratch directory, times\n"
+          "every command path through run_command and prints JSON.\n"
+          "Defaults: --sizes " DEFAULT_SIZES " --iterations %d --dir /tmp\n",
+          DEFAULT_ITERATIONS);
+}
+
+static bool parse_options(int argc, const char** argv, BenchOptions* options) {
+  options->iterations = DEFAULT_ITERATIONS;
+  options->directory = "/tmp";
+  parse_sizes(DEFAULT_SIZES, options);
+
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 == argc) return false;
+
+    const char* value = argv[++i];
+
+    if (strcmp(argv[i - 1], "--sizes") == 0) {
+      if (!parse_sizes(value, options)) return false;
+    } else if (strcmp(argv[i - 1], "--iterations") == 0) {
+      if (!parse_size(value, &options->iterations)) return false;
+    } else if (strcmp(argv[i - 1], "--dir") == 0) {
+      options->directory = value;
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, const char** argv) {
+  BenchOptions options;
+
+  if (!parse_options(argc, argv, &options)) {
+    usage();
+    return 1;
+  }
+
+  char scratch[4096];
+  int origin = open(".", O_RDONLY);
+  snprintf(scratch, sizeof(scratch), "%s/foo_bench.XXXXXX", options.directory);
+
+  if (!mkdtemp(scratch) || chdir(scratch) != 0) {
+    fprintf(stderr, "Failed to create scratch directory in '%s'.\n",
+            options.directory);
+    return 1;
+  }
+
+  double* samples = malloc(options.iterations * sizeof(double));
+
+  if (!samples) {
+    fprintf(stderr, "Failed to allocate samples.\n");
+    return 1;
+  }
+
+  int rc = 0;
+  bool first = true;
+
+  printf("{\"results\": [");
+
+  for (size_t s = 0; s < options.sizes_count && rc == 0; ++s) {
+    size_t tasks = options.sizes[s];
+
+    if (options.iterations >= tasks) {
+      fprintf(stderr, "Skipping %zu tasks: fewer than the iterations.\n",
+              tasks);
+      continue;
+    }
+
+    if (!populate(tasks)) {
+      fprintf(stderr, "Failed to populate %zu tasks.\n", tasks);
+      rc = 1;
+      break;
+    }
+
+    for (size_t c = 0; c < cases_count; ++c) {
+      if (!run_case(&cases[c], tasks, options.iterations, samples)) {
+        rc = 1;
+        break;
+      }
+
+      report(&cases[c], tasks, options.iterations, samples, first);
+      first = false;
+    }
+
+    db_close();
+    remove_database();
+  }
+
+  printf("\n]}\n");
+
+  free(samples);
+  if (origin >= 0 && fchdir(origin) == 0) rmdir(scratch);
+
+  return rc;
+}
@@ -0,0 +1,308 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#else
+#define HAVE_RDTSC 0
+#endif
+
+#include "output.h"
+#include "query_builder.h"
+#include "task.h"
+
+#define DEFAULT_SIZES "16,1024,65536"
+#define DEFAULT_MIN_TIME_MS 200
+#define MIN_REPEATS 5
+#define MAX_REPEATS 1000
+#define MAX_SIZES 16
+
+/*
+ * A benchmark body performs size operations of the primitive under test,
+ * including whatever setup and teardown a real caller would pay for.
+ * */
+typedef void (*MicroFunction)(size_t size);
+
+typedef struct {
+  const char* name;
+  MicroFunction run;
+} MicroBench;
+
+typedef struct {
+  double ns;
+  double cycles;
+} Sample;
+
+static const char* title =
+    "Write the quarterly report and send it to the whole team";
+
+static volatile size_t sink;
+static int null_fd = -1;
+
+static void bench_add_to_columns(size_t size) {
+  TaskColumns* columns = create_columns(0);
+
+  for (size_t i = 0; i < size; ++i) add_to_columns(columns, i, title, i & 1);
+
+  sink += columns->size;
+  destroy_columns(columns);
+}
+
+static void bench_add_reserved(size_t size) {
+  TaskColumns* columns = create_columns(size);
+
+  for (size_t i = 0; i < size; ++i) add_to_columns(columns, i, title, i & 1);
+
+  sink += columns->size;
+  destroy_columns(columns);
+}
+
+static TaskColumns* filled_columns(size_t size) {
+  static TaskColumns* columns = NULL;
+
+  if (columns && columns->size == size) return columns;
+  if (columns) destroy_columns(columns);
+
+  columns = create_columns(size);
+
+  for (size_t i = 0; i < size; ++i)
+    add_to_columns(columns, i, title + i % 16, i % 3 == 0);
+
+  return columns;
+}
+
+static void bench_count_finished(size_t size) {
+  TaskColumns* columns = filled_columns(size);
+  sink += count_finished(columns);
+}
+
+static void bench_partition_rows(size_t size) {
+  TaskColumns* columns = filled_columns(size);
+  size_t* rows = malloc(size * sizeof(size_t));
+
+  sink += partition_rows(columns, rows);
+  free(rows);
+}
+
+/*
+ * Renders size task lines the way list prints them.
+ * */
+static void bench_format_tasks(size_t size) {
+  static Output out;
+
+  output_init(&out, null_fd);
+
+  for (size_t i = 0; i < size; ++i) {
+    output_str(&out, "-  ");
+    output_int(&out, i, 2);
+    output_str(&out, i & 1 ? ". [x] " : ". [ ] ");
+    output_str(&out, title);
+    output_char(&out, '\n');
+  }
+
+  output_flush(&out);
+}
+
+static void bench_qb_clause(size_t size) {
+  QueryBuilder qb;
+  qb_init(&qb);
+
+  for (size_t i = 0; i < size; ++i) qb_clause(&qb, " id > 0");
+
+  sink += qb.size;
+  qb_destroy(&qb);
+}
+
+static void bench_qb_where(size_t size) {
+  QueryBuilder qb;
+  qb_init(&qb);
+  qb_clause(&qb, "SELECT id, title, finished FROM task");
+
+  for (size_t i = 0; i < size; ++i) qb_where(&qb, "finished = FALSE");
+
+  sink += qb.size;
+  qb_destroy(&qb);
+}
+
+static void bench_qb_and_or(size_t size) {
+  QueryBuilder qb;
+  qb_init(&qb);
+  qb_clause(&qb, "SELECT id FROM task");
+  qb_where(&qb, "id > 0");
+
+  for (size_t i = 0; i < size; ++i) {
+    if (i & 1)
+      qb_or(&qb);
+    else
+      qb_and(&qb);
+
+    qb_clause(&qb, "id > 0");
+  }
+
+  sink += qb.size;
+  qb_destroy(&qb);
+}
+
+static const MicroBench benches[] = {
+    {"add_to_columns", bench_add_to_columns},
+    {"add_to_columns_reserved", bench_add_reserved},
+    {"count_finished", bench_count_finished},
+    {"partition_rows", bench_partition_rows},
+    {"format_tasks", bench_format_tasks},
+    {"qb_clause", bench_qb_clause},
+    {"qb_where", bench_qb_where},
+    {"qb_and_or", bench_qb_and_or},
+};
+
+static const size_t benches_count = sizeof(benches) / sizeof(MicroBench);
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t cycles() {
+#if HAVE_RDTSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static int compare_samples(const void* a, const void* b) {
+  double left = ((const Sample*)a)->ns;
+  double right = ((const Sample*)b)->ns;
+  return (left > right) - (left < right);
+}
+
+/*
+ * Repeats the benchmark until it has run for min_time_ms and at least
+ * MIN_REPEATS times, after one untimed warm-up, and returns the per-op cost
+ * of the median repeat.
+ * */
+static Sample measure(const MicroBench* bench, size_t size,
+                      double min_time_ms) {
+  static Sample samples[MAX_REPEATS];
+  size_t repeats = 0;
+  double elapsed = 0;
+
+  bench->run(size);
+
+  while (repeats < MAX_REPEATS &&
+         (repeats < MIN_REPEATS || elapsed < min_time_ms * 1e6)) {
+    double start = now_ns();
+    uint64_t start_cycles = cycles();
+
+    bench->run(size);
+
+    uint64_t end_cycles = cycles();
+    double ns = now_ns() - start;
+
+    samples[repeats].ns = ns / size;
+    samples[repeats].cycles = (double)(end_cycles - start_cycles) / size;
+    elapsed += ns;
+    ++repeats;
+  }
+
+  qsort(samples, repeats, sizeof(Sample), compare_samples);
+
+  return samples[repeats / 2];
+}
+
+static bool parse_count(const char* text, size_t* value) {
+  char* end;
+
+  errno = 0;
+  unsigned long long parsed = strtoull(text, &end, 10);
+
+  if (errno || end == text || *end != '\0' || parsed == 0) return false;
+
+  *value = parsed;
+  return true;
+}
+
+static size_t parse_sizes(const char* text, size_t* sizes) {
+  char buffer[256];
+  size_t count = 0;
+
+  snprintf(buffer, sizeof(buffer), "%s", text);
+
+  for (char* token = strtok(buffer, ","); token; token = strtok(NULL, ",")) {
+    if (count == MAX_SIZES || !parse_count(token, &sizes[count])) return 0;
+    ++count;
+  }
+
+  return count;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "Usage: foo_microbench [--sizes <n,n,...>] [--min-time <ms>] "
+          "[--filter <name>]\n"
+          "Times the task column, output and query builder primitives and\n"
+          "prints the median cost per operation in ns and, on x86, TSC\n"
+          "cycles.\n"
+          "Defaults: --sizes " DEFAULT_SIZES " --min-time %d\n",
+          DEFAULT_MIN_TIME_MS);
+}
+
+int main(int argc, const char** argv) {
+  size_t sizes[MAX_SIZES];
+  size_t sizes_count = parse_sizes(DEFAULT_SIZES, sizes);
+  size_t min_time_ms = DEFAULT_MIN_TIME_MS;
+  const char* filter = NULL;
+
+  for (int i = 1; i < argc; i += 2) {
+    bool valid = i + 1 < argc;
+
+    if (valid && strcmp(argv[i], "--sizes") == 0)
+      valid = (sizes_count = parse_sizes(argv[i + 1], sizes)) > 0;
+    else if (valid && strcmp(argv[i], "--min-time") == 0)
+      valid = parse_count(argv[i + 1], &min_time_ms);
+    else if (valid && strcmp(argv[i], "--filter") == 0)
+      filter = argv[i + 1];
+    else
+      valid = false;
+
+    if (!valid) {
+      usage();
+      return 1;
+    }
+  }
+
+  null_fd = open("/dev/null", O_WRONLY);
+
+  if (null_fd < 0) {
+    fprintf(stderr, "Failed to open /dev/null.\n");
+    return 1;
+  }
+
+  printf("%-24s %10s %12s %12s\n", "benchmark", "size", "ns/op",
+         HAVE_RDTSC ? "cycles/op" : "");
+
+  for (size_t b = 0; b < benches_count; ++b) {
+    if (filter && !strstr(benches[b].name, filter)) continue;
+
+    for (size_t s = 0; s < sizes_count; ++s) {
+      Sample sample = measure(&benches[b], sizes[s], min_time_ms);
+
+      printf("%-24s %10zu %12.2f", benches[b].name, sizes[s], sample.ns);
+
+      if (HAVE_RDTSC) printf(" %12.2f", sample.cycles);
+
+      printf("\n");
+    }
+  }
+
+  close(null_fd);
+  return 0;
+}
@@ -1,27 +1,152 @@
 #include "command.h"
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "database.h"
+#include "generator.h"
+#include "output.h"
 #include "task.h"
+#include "timing.h"
 
-static void print_tasks(const List* list) {
-  if (list->size == 0) printf("No tasks.\n");
+#define MAX_RANGE_SPAN (1 << 24)
 
-  for (size_t i = 0; i < list->size; ++i) {
-    Task* task = &list->items[i];
+typedef QueryStatus (*RangeMutation)(int first_id, int last_id,
+                                     TaskMutation* mutation);
 
-    printf("- % 3d. [%c] %s\n", task->id, task->finished ? 'x' : ' ',
-           task->title);
+typedef struct {
+  Output out;
+  size_t printed;
+} TaskPrinter;
+
+static bool print_task(int id, const char* title, bool finished,
+                       void* context) {
+  TaskPrinter* printer = context;
+  Output* out = &printer->out;
+
+  TIMING_PUSH(PHASE_RENDER);
+
+  output_str(out, "-  ");
+  output_int(out, id, 2);
+  output_str(out, finished ? ". [x] " : ". [ ] ");
+  output_str(out, title);
+  output_char(out, '\n');
+
+  TIMING_POP();
+
+  ++printer->printed;
+
+  return !out->failed;
+}
+
+/*
+ * Loads the filtered tasks into columns and prints them in the requested
+ * order. Sorting by status only reads the finished bitmap; sorting by title
+ * only reads the title column.
+ * */
+static QueryStatus print_sorted(Filter filter, const char* sort,
+                                TaskPrinter* printer) {
+  QueryStatus status = DB_ERR;
+  TaskColumns* columns = create_columns(0);
+  size_t* rows = NULL;
+
+  if (db_list_columns(columns, filter) != DB_OK) goto cleanup;
+
+  rows = malloc((columns->size ? columns->size : 1) * sizeof(size_t));
+
+  if (!rows) {
+    fprintf(stderr, "Failed to sort tasks.\n");
+    goto cleanup;
   }
+
+  if (strcmp(sort, "title") == 0) {
+    for (size_t i = 0; i < columns->size; ++i) rows[i] = i;
+    sort_rows_by_title(columns, rows, columns->size);
+  } else {
+    partition_rows(columns, rows);
+  }
+
+  for (size_t i = 0; i < columns->size; ++i) {
+    size_t row = rows[i];
+
+    if (!print_task(columns->ids[row], column_title(columns, row),
+                    column_finished(columns, row), printer))
+      break;
+  }
+
+  status = DB_OK;
+
+cleanup:
+  free(rows);
+  destroy_columns(columns);
+  return status;
+}
+
+static void print_plan(const char* detail, void* context) {
+  (void)context;
+  printf("%s\n", detail);
+}
+
+static bool parse_id(const char* text, int* id) {
+  char* end;
+
+  errno = 0;
+  long value = strtol(text, &end, 10);
+
+  if (errno || end == text || *end != '\0' || value < 1 || value > INT_MAX)
+    return false;
+
+  *id = (int)value;
+  return true;
+}
+
+static bool parse_percent(const char* text, int* percent) {
+  char* end;
+
+  errno = 0;
+  long value = strtol(text, &end, 10);
+
+  if (errno || end == text || *end != '\0' || value < 0 || value > 100)
+    return false;
+
+  *percent = (int)value;
+  return true;
+}
+
+static char* trim(char* text) {
+  while (*text == ' ' || *text == '\t') ++text;
+
+  char* end = text + strlen(text);
+
+  while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' ||
+                        end[-1] == '\r'))
+    --end;
+
+  *end = '\0';
+  return text;
+}
+
+/*
+ * Runs a mutation on a single task, detecting missing tasks from the number
+ * of rows the mutation itself touched.
+ * */
+static int mutate_one_task(int id, RangeMutation mutation) {
+  TaskMutation result = {0};
+
+  if (mutation(id, id, &result) != DB_OK) return COMM_ERR_DATABASE;
+  if (result.changes == 0) return COMM_ERR_NOT_FOUND;
+
+  return COMM_OK;
 }
 
 int run_command(int argc, const char** argv) {
   if (argc == 1) {
-    list(argc, argv);
-    return COMM_OK;
+    db_set_access(list_command.access);
+    return list(argc, argv);
   }
 
   const char* command_name = argv[1];
@@ -36,8 +161,8 @@ int run_command(int argc, const char** argv) {
 
     if (strcmp(command->name, command_name) == 0 ||
         strcmp(command->alias, command_name) == 0) {
-      command->function(argc, argv);
-      return COMM_OK;
+      db_set_access(command->access);
+      return command->function(argc, argv);
     }
   }
 
@@ -52,7 +177,9 @@ int list(int argc, const char** argv) {
     return COMM_OK;
   }
 
-  Filter filter = {.done = false, .pending = false};
+  Filter filter = {0};
+  bool explain = false;
+  const char* sort = "id";
 
   for (int i = 2; i < argc; ++i) {
     if (strncmp(argv[i], "--help", 6) == 0) {
@@ -62,148 +189,681 @@ int list(int argc, const char** argv) {
 
     if (strncmp(argv[i], "--done", 6) == 0) {
       filter.done = true;
-      break;
+      continue;
     }
 
     if (strncmp(argv[i], "--pending", 9) == 0) {
       filter.pending = true;
-      break;
+      continue;
     }
 
-    fprintf(stderr, "Unknown argument '%s'.\n", argv[i]);
-    return COMM_ERR_INVALID_ARGS;
-  }
+    if (strcmp(argv[i], "--explain") == 0) {
+      explain = true;
+      continue;
+    }
 
-  List* tasks = create_list();
+    if (strcmp(argv[i], "--sort") == 0) {
+      if (i + 1 == argc || (strcmp(argv[i + 1], "id") != 0 &&
+                            strcmp(argv[i + 1], "title") != 0 &&
+                            strcmp(argv[i + 1], "status") != 0)) {
+        fprintf(stderr, "Invalid value for '%s'.\n", argv[i]);
+        return COMM_ERR_INVALID_ARGS;
+      }
 
-  if (db_list_tasks(tasks, filter) != DB_OK) {
-    return COMM_ERR_DATABASE;
+      sort = argv[++i];
+      continue;
+    }
+
+    int* value = NULL;
+
+    if (strcmp(argv[i], "--limit") == 0) value = &filter.limit;
+    if (strcmp(argv[i], "--after") == 0) value = &filter.after;
+    if (strcmp(argv[i], "--before") == 0) value = &filter.before;
+
+    if (!value) {
+      fprintf(stderr, "Unknown argument '%s'.\n", argv[i]);
+      return COMM_ERR_INVALID_ARGS;
+    }
+
+    if (i + 1 == argc || !parse_id(argv[i + 1], value)) {
+      fprintf(stderr, "Invalid value for '%s'.\n", argv[i]);
+      return COMM_ERR_INVALID_ARGS;
+    }
+
+    ++i;
   }
 
-  print_tasks(tasks);
+  if (explain) {
+    return db_explain_tasks(filter, print_plan, NULL) == DB_OK
+               ? COMM_OK
+               : COMM_ERR_DATABASE;
+  }
+
+  static TaskPrinter printer;
+
+  output_init(&printer.out, STDOUT_FILENO);
+  printer.printed = 0;
+
+  QueryStatus rc = strcmp(sort, "id") == 0
+                       ? db_each_task(filter, print_task, &printer)
+                       : print_sorted(filter, sort, &printer);
+
+  if (rc == DB_OK && printer.printed == 0)
+    output_str(&printer.out, "No tasks.\n");
 
-  destroy_list(tasks);
+  TIMING_PUSH(PHASE_RENDER);
+  output_flush(&printer.out);
+  TIMING_POP();
+
+  return rc == DB_OK ? COMM_OK : COMM_ERR_DATABASE;
+}
+
+typedef struct {
+  int first_id;
+  int last_id;
+  size_t count;
+} AddSummary;
+
+static int add_title(const char* title, AddSummary* summary) {
+  int id;
+
+  if (db_create_task(title, &id) != DB_OK) return COMM_ERR_DATABASE;
+
+  if (summary->count++ == 0) summary->first_id = id;
+  summary->last_id = id;
 
   return COMM_OK;
 }
 
+static int add_titles_from(FILE* input, AddSummary* summary) {
+  int status = COMM_OK;
+  char* line = NULL;
+  size_t line_capacity = 0;
+
+  while (getline(&line, &line_capacity, input) != -1) {
+    char* title = trim(line);
+    if (*title == '\0') continue;
+
+    if ((status = add_title(title, summary)) != COMM_OK) break;
+  }
+
+  free(line);
+  return status;
+}
+
 int add(int argc, const char** argv) {
   if (argc < 3) {
     fprintf(stderr, "Missing task info.\n");
     return COMM_ERR_INVALID_ARGS;
   }
 
-  if (strncmp(argv[2], "--help", 6) == 0) {
-    printf("%s", add_command.help);
-    return COMM_OK;
+  bool from_stdin = false;
+
+  for (int i = 2; i < argc; ++i) {
+    if (strncmp(argv[i], "--help", 6) == 0) {
+      printf("%s", add_command.help);
+      return COMM_OK;
+    }
+
+    if (strcmp(argv[i], "--stdin") == 0) from_stdin = true;
   }
 
-  const char* task_title = argv[2];
+  AddSummary summary = {0};
 
-  Task* task = create_task(task_title);
+  if (db_begin() != DB_OK) return COMM_ERR_DATABASE;
 
-  if (db_create_task(task) != DB_OK) {
-    destroy_task(task);
-    return COMM_ERR_DATABASE;
+  for (int i = 2; i < argc; ++i) {
+    if (strcmp(argv[i], "--stdin") == 0) continue;
+
+    if (add_title(argv[i], &summary) != COMM_OK) goto rollback;
   }
 
-  destroy_task(task);
+  if (from_stdin && add_titles_from(stdin, &summary) != COMM_OK) goto rollback;
+
+  if (db_commit() != DB_OK) goto rollback;
+
+  if (summary.count == 1) printf("Added task %d.\n", summary.first_id);
+
+  if (summary.count > 1)
+    printf("Added %zu tasks (%d-%d).\n", summary.count, summary.first_id,
+           summary.last_id);
 
   return COMM_OK;
+
+rollback:
+  db_rollback();
+  return COMM_ERR_DATABASE;
 }
 
-int check(int argc, const char** argv) {
+typedef struct {
+  int first;
+  int last;
+} IdRange;
+
+typedef struct {
+  IdRange range;
+  unsigned char* found;
+  unsigned char* finished;
+} RangeMatches;
+
+typedef bool (*RangePredicate)(const RangeMatches* matches, size_t offset);
+
+static bool parse_range(const char* text, IdRange* range) {
+  const char* dash = strchr(text, '-');
+
+  if (!dash) {
+    if (!parse_id(text, &range->first)) return false;
+    range->last = range->first;
+    return true;
+  }
+
+  char first[16];
+  size_t first_size = dash - text;
+
+  if (first_size == 0 || first_size >= sizeof(first)) return false;
+
+  memcpy(first, text, first_size);
+  first[first_size] = '\0';
+
+  if (!parse_id(first, &range->first) || !parse_id(dash + 1, &range->last))
+    return false;
+
+  return range->first <= range->last &&
+         range->last - range->first < MAX_RANGE_SPAN;
+}
+
+static int compare_ranges(const void* a, const void* b) {
+  const IdRange* left = a;
+  const IdRange* right = b;
+
+  return (left->first > right->first) - (left->first < right->first);
+}
+
+/*
+ * Sorts the ranges and merges overlapping or adjacent ones in place.
+ * Returns the number of ranges left.
+ * */
+static size_t merge_ranges(IdRange* ranges, size_t count) {
+  qsort(ranges, count, sizeof(IdRange), compare_ranges);
+
+  size_t merged = 0;
+
+  for (size_t i = 1; i < count; ++i) {
+    IdRange* last = &ranges[merged];
+
+    if (ranges[i].first <= last->last ||
+        ranges[i].first - last->last == 1) {
+      if (ranges[i].last > last->last) last->last = ranges[i].last;
+      continue;
+    }
+
+    ranges[++merged] = ranges[i];
+  }
+
+  return count ? merged + 1 : 0;
+}
+
+static bool test_bit(const unsigned char* bits, size_t offset) {
+  return bits[offset / 8] & (1u << (offset % 8));
+}
+
+static void set_bit(unsigned char* bits, size_t offset) {
+  bits[offset / 8] |= 1u << (offset % 8);
+}
+
+static void mark_found(int id, bool was_finished, void* context) {
+  RangeMatches* matches = context;
+  size_t offset = id - matches->range.first;
+
+  set_bit(matches->found, offset);
+  if (was_finished) set_bit(matches->finished, offset);
+}
+
+static bool is_missing(const RangeMatches* matches, size_t offset) {
+  return !test_bit(matches->found, offset);
+}
+
+static bool is_already_finished(const RangeMatches* matches, size_t offset) {
+  return test_bit(matches->found, offset) &&
+         test_bit(matches->finished, offset);
+}
+
+static bool is_already_pending(const RangeMatches* matches, size_t offset) {
+  return test_bit(matches->found, offset) &&
+         !test_bit(matches->finished, offset);
+}
+
+/*
+ * Prints "<label>: a, b-c, ..." for every run of ids matching the predicate.
+ * Returns whether anything was printed.
+ * */
+static bool report_runs(FILE* stream, const char* label,
+                        const RangeMatches* matches, size_t count,
+                        RangePredicate selected) {
+  size_t reported = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t span = (size_t)matches[i].range.last - matches[i].range.first + 1;
+
+    for (size_t offset = 0; offset < span; ++offset) {
+      if (!selected(&matches[i], offset)) continue;
+
+      size_t first = offset;
+
+      while (offset + 1 < span && selected(&matches[i], offset + 1)) ++offset;
+
+      fprintf(stream, "%s%d", reported++ ? ", " : label,
+              matches[i].range.first + (int)first);
+      if (offset != first)
+        fprintf(stream, "-%d", matches[i].range.first + (int)offset);
+    }
+  }
+
+  if (reported) fprintf(stream, ".\n");
+
+  return reported;
+}
+
+static void free_matches(RangeMatches* matches, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    free(matches[i].found);
+    free(matches[i].finished);
+  }
+
+  free(matches);
+}
+
+/*
+ * Applies a set-based mutation to every id and range given on the command
+ * line inside one transaction, then reports the ids that did not exist and,
+ * through the optional predicate, the ids that were already in the target
+ * state.
+ * */
+static int mutate_ranges(int argc, const char** argv, const Command* command,
+                         RangeMutation mutation, const char* unchanged_label,
+                         RangePredicate unchanged) {
   if (argc < 3) {
     fprintf(stderr, "Missing task ID.\n");
     return COMM_ERR_INVALID_ARGS;
   }
 
-  if (strncmp(argv[2], "--help", 6) == 0) {
-    printf("%s", check_command.help);
-    return COMM_OK;
+  for (int i = 2; i < argc; ++i) {
+    if (strncmp(argv[i], "--help", 6) == 0) {
+      printf("%s", command->help);
+      return COMM_OK;
+    }
   }
 
-  int id = atoi(argv[2]);
-  Task task;
+  size_t count = argc - 2;
+  IdRange* ranges = malloc(count * sizeof(IdRange));
+  RangeMatches* matches = calloc(count, sizeof(RangeMatches));
 
-  int rc = db_list_task(id, &task);
+  if (!ranges || !matches) {
+    fprintf(stderr, "Failed to allocate ID ranges.\n");
+    exit(1);
+  }
 
-  if (rc == DB_ERR) {
-    return COMM_ERR_DATABASE;
+  int status = COMM_OK;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (!parse_range(argv[i + 2], &ranges[i])) {
+      fprintf(stderr, "Invalid task ID '%s'.\n", argv[i + 2]);
+      status = COMM_ERR_INVALID_ARGS;
+      goto cleanup;
+    }
   }
 
-  if (rc == DB_NOT_FOUND) {
-    fprintf(stderr, "Not found.\n");
-    return COMM_ERR_NOT_FOUND;
+  count = merge_ranges(ranges, count);
+
+  /* Adjacent ranges merge into one bitmap, so bound the merged span too. */
+  for (size_t i = 0; i < count; ++i) {
+    if (ranges[i].last - ranges[i].first >= MAX_RANGE_SPAN) {
+      fprintf(stderr, "Task ID range %d-%d is too large.\n", ranges[i].first,
+              ranges[i].last);
+      status = COMM_ERR_INVALID_ARGS;
+      goto cleanup;
+    }
   }
 
-  if (db_check_task(id) != DB_OK) {
-    return COMM_ERR_DATABASE;
+  if (db_begin() != DB_OK) {
+    status = COMM_ERR_DATABASE;
+    goto cleanup;
   }
 
-  return COMM_OK;
+  for (size_t i = 0; i < count; ++i) {
+    size_t bitmap_size = ((size_t)ranges[i].last - ranges[i].first + 8) / 8;
+
+    matches[i].range = ranges[i];
+    matches[i].found = calloc(bitmap_size, 1);
+    matches[i].finished = calloc(bitmap_size, 1);
+
+    if (!matches[i].found || !matches[i].finished) {
+      fprintf(stderr, "Failed to allocate ID set.\n");
+      exit(1);
+    }
+
+    TaskMutation result = {.changed = mark_found, .context = &matches[i]};
+
+    if (mutation(ranges[i].first, ranges[i].last, &result) != DB_OK) {
+      db_rollback();
+      status = COMM_ERR_DATABASE;
+      goto cleanup;
+    }
+  }
+
+  if (db_commit() != DB_OK) {
+    db_rollback();
+    status = COMM_ERR_DATABASE;
+    goto cleanup;
+  }
+
+  if (unchanged)
+    report_runs(stdout, unchanged_label, matches, count, unchanged);
+
+  if (report_runs(stderr, "Not found: ", matches, count, is_missing))
+    status = COMM_ERR_NOT_FOUND;
+
+cleanup:
+  free(ranges);
+  free_matches(matches, argc - 2);
+  return status;
+}
+
+int check(int argc, const char** argv) {
+  return mutate_ranges(argc, argv, &check_command, db_check_tasks,
+                       "Already completed: ", is_already_finished);
 }
 
 int uncheck(int argc, const char** argv) {
-  if (argc < 3) {
-    fprintf(stderr, "Missing task ID.\n");
+  return mutate_ranges(argc, argv, &uncheck_command, db_uncheck_tasks,
+                       "Already pending: ", is_already_pending);
+}
+
+int del(int argc, const char** argv) {
+  return mutate_ranges(argc, argv, &del_command, db_delete_tasks, NULL, NULL);
+}
+
+static bool is_command(const char* name, const Command* command) {
+  return strcmp(name, command->name) == 0 || strcmp(name, command->alias) == 0;
+}
+
+/*
+ * Executes one batch line of the form "<command> <argument>", reporting
+ * problems with the line itself together with its line number.
+ * */
+static int run_batch_line(char* line, size_t line_number) {
+  char* name = line;
+  char* arg = line + strcspn(line, " \t");
+
+  if (*arg != '\0') *arg++ = '\0';
+  arg = trim(arg);
+
+  if (*arg == '\0') {
+    fprintf(stderr, "Missing argument for '%s' on line %zu.\n", name,
+            line_number);
     return COMM_ERR_INVALID_ARGS;
   }
 
-  if (strncmp(argv[2], "--help", 6) == 0) {
-    printf("%s", uncheck_command.help);
-    return COMM_OK;
+  if (is_command(name, &add_command)) {
+    return db_create_task(arg, NULL) == DB_OK ? COMM_OK : COMM_ERR_DATABASE;
   }
 
-  int id = atoi(argv[2]);
-  Task task;
+  RangeMutation mutation = NULL;
 
-  int rc = db_list_task(id, &task);
+  if (is_command(name, &check_command)) mutation = db_check_tasks;
+  if (is_command(name, &uncheck_command)) mutation = db_uncheck_tasks;
+  if (is_command(name, &del_command)) mutation = db_delete_tasks;
 
-  if (rc == DB_ERR) {
-    return COMM_ERR_DATABASE;
+  if (!mutation) {
+    fprintf(stderr, "Unknown command '%s' on line %zu.\n", name,
+            line_number);
+    return COMM_ERR_INVALID_COMM;
   }
 
-  if (rc == DB_NOT_FOUND) {
-    fprintf(stderr, "Not found.\n");
-    return COMM_ERR_NOT_FOUND;
-  }
+  int id;
 
-  if (db_uncheck_task(id)) {
-    return COMM_ERR_DATABASE;
+  if (!parse_id(arg, &id)) {
+    fprintf(stderr, "Invalid task ID '%s' on line %zu.\n", arg,
+            line_number);
+    return COMM_ERR_INVALID_ARGS;
   }
 
-  return COMM_OK;
+  int rc = mutate_one_task(id, mutation);
+
+  if (rc == COMM_ERR_NOT_FOUND)
+    fprintf(stderr, "Task %d not found on line %zu.\n", id, line_number);
+
+  return rc;
 }
 
-int del(int argc, const char** argv) {
-  if (argc < 3) {
-    fprintf(stderr, "Missing task ID.\n");
+int batch(int argc, const char** argv) {
+  const char* path = NULL;
+  long commit_every = 0;
+
+  for (int i = 2; i < argc; ++i) {
+    if (strncmp(argv[i], "--help", 6) == 0) {
+      printf("%s", batch_command.help);
+      return COMM_OK;
+    }
+
+    if (strcmp(argv[i], "--commit-every") == 0) {
+      char* end;
+
+      if (i + 1 == argc ||
+          (commit_every = strtol(argv[++i], &end, 10)) < 0 || *end != '\0') {
+        fprintf(stderr, "Invalid commit interval.\n");
+        return COMM_ERR_INVALID_ARGS;
+      }
+
+      continue;
+    }
+
+    if (path) {
+      fprintf(stderr, "Unknown argument '%s'.\n", argv[i]);
+      return COMM_ERR_INVALID_ARGS;
+    }
+
+    path = argv[i];
+  }
+
+  FILE* input = stdin;
+
+  if (path && strcmp(path, "-") != 0 && !(input = fopen(path, "r"))) {
+    fprintf(stderr, "Failed to open '%s'.\n", path);
     return COMM_ERR_INVALID_ARGS;
   }
 
-  if (strncmp(argv[2], "--help", 6) == 0) {
-    printf("%s", del_command.help);
-    return COMM_OK;
+  int status = COMM_OK;
+  char* line = NULL;
+  size_t line_capacity = 0;
+  size_t line_number = 0;
+  long pending = 0;
+
+  if (db_begin() != DB_OK) goto rollback;
+
+  while (getline(&line, &line_capacity, input) != -1) {
+    ++line_number;
+
+    char* command = trim(line);
+    if (*command == '\0' || *command == '#') continue;
+
+    int rc = run_batch_line(command, line_number);
+
+    if (rc == COMM_ERR_DATABASE) {
+      fprintf(stderr, "Batch aborted at line %zu.\n", line_number);
+      goto rollback;
+    }
+
+    if (rc != COMM_OK) {
+      if (status == COMM_OK) status = rc;
+      continue;
+    }
+
+    if (commit_every && ++pending == commit_every) {
+      if (db_commit() != DB_OK || db_begin() != DB_OK) goto rollback;
+
+      pending = 0;
+    }
   }
 
-  int id = atoi(argv[2]);
-  Task task;
+  if (db_commit() == DB_OK) goto cleanup;
 
-  int rc = db_list_task(id, &task);
+rollback:
+  db_rollback();
+  status = COMM_ERR_DATABASE;
 
-  if (rc == DB_ERR) {
-    return COMM_ERR_DATABASE;
+cleanup:
+  free(line);
+  if (input != stdin) fclose(input);
+  return status;
+}
+
+/*
+ * Runs a full-text search. Several query words are joined with spaces, which
+ * FTS5 treats as AND.
+ * */
+int search(int argc, const char** argv) {
+  int limit = 0;
+  size_t query_size = 0;
+
+  for (int i = 2; i < argc; ++i) {
+    if (strncmp(argv[i], "--help", 6) == 0) {
+      printf("%s", search_command.help);
+      return COMM_OK;
+    }
+
+    if (strcmp(argv[i], "--limit") == 0) {
+      if (i + 1 == argc || !parse_id(argv[i + 1], &limit)) {
+        fprintf(stderr, "Invalid value for '%s'.\n", argv[i]);
+        return COMM_ERR_INVALID_ARGS;
+      }
+
+      ++i;
+      continue;
+    }
+
+    query_size += strlen(argv[i]) + 1;
   }
 
-  if (rc == DB_NOT_FOUND) {
-    fprintf(stderr, "Not found.\n");
-    return COMM_ERR_NOT_FOUND;
+  if (query_size == 0) {
+    printf("%s", search_command.help);
+    return COMM_ERR_INVALID_ARGS;
   }
 
-  if (db_delete_task(id) == DB_OK) {
+  char* query = malloc(query_size);
+
+  if (!query) {
+    fprintf(stderr, "Failed to allocate the search query.\n");
     return COMM_ERR_DATABASE;
   }
 
+  query[0] = '\0';
+
+  for (int i = 2; i < argc; ++i) {
+    if (strcmp(argv[i], "--limit") == 0) {
+      ++i;
+      continue;
+    }
+
+    if (query[0]) strcat(query, " ");
+    strcat(query, argv[i]);
+  }
+
+  static TaskPrinter printer;
+
+  output_init(&printer.out, STDOUT_FILENO);
+  printer.printed = 0;
+
+  QueryStatus rc = db_search_tasks(query, limit, print_task, &printer);
+
+  if (rc == DB_OK && printer.printed == 0)
+    output_str(&printer.out, "No matching tasks.\n");
+
+  TIMING_PUSH(PHASE_RENDER);
+  output_flush(&printer.out);
+  TIMING_POP();
+  free(query);
+
+  return rc == DB_OK ? COMM_OK : COMM_ERR_DATABASE;
+}
+
+int gen(int argc, const char** argv) {
+  GeneratorOptions options = {.seed = GEN_DEFAULT_SEED,
+                              .done_percent = GEN_DEFAULT_DONE_PERCENT,
+                              .days = GEN_DEFAULT_DAYS};
+  int count = 0;
+
+  for (int i = 2; i < argc; ++i) {
+    if (strncmp(argv[i], "--help", 6) == 0) {
+      printf("%s", gen_command.help);
+      return COMM_OK;
+    }
+
+    if (argv[i][0] != '-') {
+      if (count || !parse_id(argv[i], &count)) {
+        fprintf(stderr, "Invalid task count '%s'.\n", argv[i]);
+        return COMM_ERR_INVALID_ARGS;
+      }
+
+      continue;
+    }
+
+    int seed = 0;
+    bool valid = i + 1 < argc;
+
+    if (valid && strcmp(argv[i], "--seed") == 0) {
+      valid = parse_id(argv[i + 1], &seed);
+      options.seed = seed;
+    } else if (valid && strcmp(argv[i], "--done") == 0) {
+      valid = parse_percent(argv[i + 1], &options.done_percent);
+    } else if (valid && strcmp(argv[i], "--days") == 0) {
+      valid = parse_id(argv[i + 1], &options.days);
+    } else if (valid) {
+      fprintf(stderr, "Unknown argument '%s'.\n", argv[i]);
+      return COMM_ERR_INVALID_ARGS;
+    }
+
+    if (!valid) {
+      fprintf(stderr, "Invalid value for '%s'.\n", argv[i]);
+      return COMM_ERR_INVALID_ARGS;
+    }
+
+    ++i;
+  }
+
+  if (count == 0) {
+    printf("%s", gen_command.help);
+    return COMM_ERR_INVALID_ARGS;
+  }
+
+  options.count = count;
+
+  int first_id, last_id;
+
+  if (generate_tasks(&options, &first_id, &last_id) != DB_OK)
+    return COMM_ERR_DATABASE;
+
+  printf("Generated %d tasks (%d-%d).\n", count, first_id, last_id);
+
   return COMM_OK;
 }
+
+static void print_setting(const char* name, const char* value,
+                          void* context) {
+  (void)context;
+  printf("%-14s%s\n", name, value);
+}
+
+int database(int argc, const char** argv) {
+  if (argc < 3 || strncmp(argv[2], "--help", 6) == 0) {
+    printf("%s", database_command.help);
+    return argc < 3 ? COMM_ERR_INVALID_ARGS : COMM_OK;
+  }
+
+  if (strcmp(argv[2], "info") != 0 || argc > 3) {
+    fprintf(stderr, "Unknown argument '%s'.\n", argv[argc > 3 ? 3 : 2]);
+    return COMM_ERR_INVALID_ARGS;
+  }
+
+  return db_info(print_setting, NULL) == DB_OK ? COMM_OK : COMM_ERR_DATABASE;
+}
@@ -3,6 +3,9 @@
 
 #include <stddef.h>
 
+#include "database.h"
+#include "server.h"
+
 typedef enum {
   COMM_OK,
   COMM_ERR_INVALID_COMM,
@@ -13,10 +16,16 @@ typedef enum {
 
 typedef int (*CommandFunction)(int argc, const char** argv);
 
+/*
+ * The connection is opened on the first database call a command makes, with
+ * the access declared here, so help output and argument errors never touch
+ * foo.db.
+ * */
 typedef struct {
   const char* name;
   const char* alias;
   CommandFunction function;
+  DatabaseAccess access;
   const char* help;
 } Command;
 
@@ -27,8 +36,12 @@ int add(int argc, const char** argv);
 int check(int argc, const char** argv);
 int uncheck(int argc, const char** argv);
 int del(int argc, const char** argv);
+int batch(int argc, const char** argv);
+int search(int argc, const char** argv);
+int gen(int argc, const char** argv);
+int database(int argc, const char** argv);
 
-static const char* general_help =
+static const char general_help[] =
     "foo - simple and fast task manager\n"
     "\n"
     "Usage:\n"
@@ -37,58 +50,170 @@ static const char* general_help =
     "\n"
     "Commands:\n"
     "  list        List all tasks\n"
-    "  add         Add a new task\n"
-    "  check       Mark a task as completed\n"
-    "  uncheck     Mark a task as pending\n"
-    "  del         Delete a task\n"
+    "  add         Add one or more tasks\n"
+    "  check       Mark tasks as completed\n"
+    "  uncheck     Mark tasks as pending\n"
+    "  del         Delete tasks\n"
+    "  search      Find tasks by the words in them\n"
+    "  gen         Fill the database with synthetic tasks\n"
+    "  batch       Run many commands in one transaction\n"
+    "  db          Inspect the database storage settings\n"
+    "  serve       Keep the database open for other foo processes\n"
     "\n"
     "Options:\n"
-    "  --help      Show this help message\n";
+    "  --help      Show this help message\n"
+    "  --timing    Report wall and CPU time per phase on stderr\n"
+    "              (also FOO_TIMING=1)\n"
+    "  --profile[=json]\n"
+    "              Report per-statement SQL costs on stderr\n"
+    "              (also FOO_PROFILE=1 or FOO_PROFILE=json)\n";
 
 static const Command list_command = {
     .name = "list",
     .alias = "ps",
     .function = list,
+    .access = DB_ACCESS_READ_ONLY,
     .help =
         "List all tasks.\n"
-        "Usage: foo list\n"
-        "Shows pending and completed tasks.\n"};
-
-static const Command add_command = {.name = "add",
-                                    .alias = "a",
-                                    .function = add,
-                                    .help =
-                                        "Add a new task.\n"
-                                        "Usage: foo add <title>\n"
-                                        "Example: foo add \"Study SQLite\"\n"};
-
-static const Command check_command = {.name = "check",
-                                      .alias = "c",
-                                      .function = check,
-                                      .help =
-                                          "Mark a task as completed.\n"
-                                          "Usage: foo check <id>\n"
-                                          "Example: foo check 3\n"};
+        "Usage: foo list [--done | --pending] [--limit <n>]\n"
+        "                [--after <id>] [--before <id>] [--explain]\n"
+        "                [--sort id|title|status]\n"
+        "Shows pending and completed tasks ordered by id.\n"
+        "--after and --before page through tasks by id; with --limit,\n"
+        "--before returns the <n> tasks right before <id>.\n"
+        "--explain prints the query plan instead of the tasks.\n"
+        "--sort title orders the selected tasks by title; --sort status\n"
+        "shows pending tasks before completed ones.\n"
+        "Example: foo list --pending --after 120 --limit 50\n"};
+
+static const Command add_command = {
+    .name = "add",
+    .alias = "a",
+    .function = add,
+    .access = DB_ACCESS_READ_WRITE,
+    .help =
+        "Add one or more tasks in a single transaction.\n"
+        "Usage: foo add <title>... [--stdin]\n"
+        "--stdin also reads one title per line from standard input.\n"
+        "Example: foo add \"Study SQLite\" \"Write tests\"\n"};
+
+static const Command check_command = {
+    .name = "check",
+    .alias = "c",
+    .function = check,
+    .access = DB_ACCESS_READ_WRITE,
+    .help =
+        "Mark tasks as completed.\n"
+        "Usage: foo check <id|first-last>...\n"
+        "All ids are processed in one transaction; missing ones are "
+        "reported.\n"
+        "Example: foo check 3 7 10-20\n"};
 
 static const Command uncheck_command = {
     .name = "uncheck",
     .alias = "u",
     .function = uncheck,
+    .access = DB_ACCESS_READ_WRITE,
+    .help =
+        "Mark completed tasks as pending again.\n"
+        "Usage: foo uncheck <id|first-last>...\n"
+        "All ids are processed in one transaction; missing ones are "
+        "reported.\n"
+        "Example: foo uncheck 3 7 10-20\n"};
+
+static const Command del_command = {
+    .name = "del",
+    .alias = "d",
+    .function = del,
+    .access = DB_ACCESS_READ_WRITE,
+    .help =
+        "Delete tasks.\n"
+        "Usage: foo del <id|first-last>...\n"
+        "All ids are processed in one transaction; missing ones are "
+        "reported.\n"
+        "Example: foo del 3 7 10-20\n"};
+
+static const Command batch_command = {
+    .name = "batch",
+    .alias = "b",
+    .function = batch,
+    .access = DB_ACCESS_READ_WRITE,
     .help =
-        "Mark a completed task as pending again.\n"
-        "Usage: foo uncheck <id>\n"
-        "Example: foo uncheck 3\n"};
-
-static const Command del_command = {.name = "del",
-                                    .alias = "d",
-                                    .function = del,
-                                    .help =
-                                        "Delete a task.\n"
-                                        "Usage: foo del <id>\n"
-                                        "Example: foo del 3\n"};
-
-static const Command* commands[] = {&list_command, &add_command, &check_command,
-                                    &uncheck_command, &del_command};
+        "Run newline-delimited commands in a single transaction.\n"
+        "Usage: foo batch [<file>] [--commit-every <n>]\n"
+        "Reads from standard input when no file (or '-') is given.\n"
+        "Supported commands: add <title>, check <id>, uncheck <id>, "
+        "del <id>.\n"
+        "--commit-every commits after every <n> successful commands.\n"
+        "Example: printf 'add Study SQLite\\ncheck 3\\n' | foo batch\n"};
+
+static const Command search_command = {
+    .name = "search",
+    .alias = "s",
+    .function = search,
+    .access = DB_ACCESS_READ_ONLY,
+    .help =
+        "Search task titles and descriptions.\n"
+        "Usage: foo search <query> [--limit <n>]\n"
+        "Shows the best matches first, with matched words marked by '*'.\n"
+        "The query uses SQLite FTS5 syntax: 'word*' matches a prefix,\n"
+        "\"quoted words\" match a phrase, and AND, OR and NOT combine terms.\n"
+        "Example: foo search \"deploy*\" --limit 10\n"};
+
+static const Command gen_command = {
+    .name = "gen",
+    .alias = "gen",
+    .function = gen,
+    .access = DB_ACCESS_READ_WRITE,
+    .help =
+        "Fill the database with synthetic tasks for benchmarks and tests.\n"
+        "Usage: foo gen <count> [--seed <n>] [--done <percent>]\n"
+        "                       [--days <n>]\n"
+        "Titles and descriptions follow a fixed length histogram;\n"
+        "--done sets the share of completed tasks (default 30) and\n"
+        "--days how far created_at is spread from 2024-01-01 (default\n"
+        "365). The same options always generate the same tasks.\n"
+        "FOO_TUNING=fast speeds up large runs.\n"
+        "Example: foo gen 1000000 --seed 7\n"};
+
+static const Command database_command = {
+    .name = "db",
+    .alias = "db",
+    .function = database,
+    .access = DB_ACCESS_READ_ONLY,
+    .help =
+        "Inspect the database.\n"
+        "Usage: foo db info\n"
+        "Prints the tuning profile and the storage settings in effect.\n"
+        "The profile is chosen with FOO_TUNING or 'tuning = <name>' in\n"
+        "foo.conf: durable (default), balanced or fast.\n"
+        "The journal mode and page size are stored in foo.db and only\n"
+        "change when it is created or its schema is migrated.\n"
+        "FOO_MODE=memory (or 'mode = memory') works on an in-memory copy\n"
+        "of foo.db that is written back at each commit and on exit. It\n"
+        "keeps foo.db locked meanwhile: other foo processes fail with\n"
+        "'database is locked' until it exits.\n"};
+
+static const Command serve_command = {
+    .name = "serve",
+    .alias = "serve",
+    .function = serve,
+    .access = DB_ACCESS_READ_WRITE,
+    .help =
+        "Serve other foo processes from one warm database connection.\n"
+        "Usage: foo serve\n"
+        "Listens on foo.sock in the working directory until interrupted.\n"
+        "While it runs, foo commands started in that directory are\n"
+        "executed by the server; without it they run directly. Commands\n"
+        "reading standard input (add --stdin, batch without a file) always\n"
+        "run directly.\n"
+        "Settings such as FOO_TUNING and FOO_MODE are the server's.\n"};
+
+static const Command* commands[] = {&list_command,    &add_command,
+                                    &check_command,   &uncheck_command,
+                                    &del_command,     &batch_command,
+                                    &search_command,  &gen_command,
+                                    &database_command, &serve_command};
 
 static const size_t commands_count = sizeof(commands) / sizeof(Command*);
 
@@ -0,0 +1,85 @@
+#include "config.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONFIG_PATH "foo.conf"
+#define CONFIG_MAX_ENTRIES 16
+#define CONFIG_KEY_SIZE 32
+#define CONFIG_VALUE_SIZE 64
+
+typedef struct {
+  char key[CONFIG_KEY_SIZE];
+  char value[CONFIG_VALUE_SIZE];
+} ConfigEntry;
+
+static ConfigEntry entries[CONFIG_MAX_ENTRIES];
+static size_t entries_count = 0;
+static bool loaded = false;
+
+static char* strip(char* text) {
+  while (isspace((unsigned char)*text)) ++text;
+
+  char* end = text + strlen(text);
+  while (end > text && isspace((unsigned char)end[-1])) --end;
+  *end = '\0';
+
+  return text;
+}
+
+/*
+ * Reads "key = value" lines from foo.conf in the working directory. Blank
+ * lines and lines starting with '#' are ignored; a missing file is not an
+ * error.
+ * */
+static void load_config() {
+  loaded = true;
+
+  FILE* file = fopen(CONFIG_PATH, "r");
+  if (!file) return;
+
+  char line[CONFIG_KEY_SIZE + CONFIG_VALUE_SIZE + 8];
+
+  while (fgets(line, sizeof(line), file) &&
+         entries_count < CONFIG_MAX_ENTRIES) {
+    char* text = strip(line);
+    char* equals = strchr(text, '=');
+
+    if (*text == '#' || !equals) continue;
+
+    *equals = '\0';
+
+    ConfigEntry* entry = &entries[entries_count++];
+    snprintf(entry->key, sizeof(entry->key), "%s", strip(text));
+    snprintf(entry->value, sizeof(entry->value), "%s", strip(equals + 1));
+  }
+
+  fclose(file);
+}
+
+/*
+ * Looks a setting up, first in the FOO_<KEY> environment variable and then
+ * in foo.conf. Returns NULL when it is set in neither.
+ * */
+const char* config_get(const char* key) {
+  char variable[CONFIG_KEY_SIZE + 4] = "FOO_";
+
+  for (size_t i = 0; key[i] && i < CONFIG_KEY_SIZE - 1; ++i) {
+    variable[i + 4] = toupper((unsigned char)key[i]);
+    variable[i + 5] = '\0';
+  }
+
+  const char* value = getenv(variable);
+  if (value && *value) return value;
+
+  if (!loaded) load_config();
+
+  for (size_t i = 0; i < entries_count; ++i) {
+    if (strcmp(entries[i].key, key) == 0) return entries[i].value;
+  }
+
+  return NULL;
+}
@@ -0,0 +1,6 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+const char* config_get(const char* key);
+
+#endif
@@ -3,67 +3,393 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "config.h"
+#include "migration.h"
+#include "profiler.h"
 #include "query_builder.h"
 #include "sqlite3.h"
 #include "task.h"
+#include "timing.h"
+#include "tuning.h"
 
 sqlite3* db = NULL;
 
+/* The on-disk database while db is an in-memory copy of it. */
+static sqlite3* disk = NULL;
+static sqlite3_int64 snapshot_changes = 0;
+
+typedef enum {
+  STMT_CREATE_TASK,
+  STMT_INSERT_TASK,
+  STMT_CHECK_TASKS,
+  STMT_UNCHECK_TASKS,
+  STMT_DELETE_TASKS,
+  STMT_SEARCH_TASKS,
+  STMT_MAX_ID,
+  STMT_BEGIN,
+  STMT_COMMIT,
+  STMT_ROLLBACK,
+  STMT_COUNT,
+} StatementId;
+
+#define INSERT_TASK_SQL \
+  "INSERT INTO task(title, description, finished, created_at) VALUES "
+#define INSERT_TASK_VALUES "(?, ?, ?, datetime(?, 'unixepoch'))"
+
+static const char* statement_sql[STMT_COUNT] = {
+    [STMT_CREATE_TASK] =
+        "INSERT INTO task(title, description, finished) VALUES(?, ?, ?)",
+    [STMT_INSERT_TASK] = INSERT_TASK_SQL INSERT_TASK_VALUES,
+    [STMT_CHECK_TASKS] =
+        "UPDATE task SET finished = task_transition(?3, id, finished, TRUE) "
+        "WHERE id BETWEEN ?1 AND ?2",
+    [STMT_UNCHECK_TASKS] =
+        "UPDATE task SET finished = task_transition(?3, id, finished, FALSE) "
+        "WHERE id BETWEEN ?1 AND ?2",
+    [STMT_DELETE_TASKS] =
+        "DELETE FROM task WHERE id BETWEEN ?1 AND ?2 RETURNING id, finished",
+    [STMT_SEARCH_TASKS] =
+        "SELECT task.id, snippet(task_search, -1, '*', '*', '...', 12), "
+        "task.finished FROM task_search JOIN task ON task.id = "
+        "task_search.rowid WHERE task_search MATCH ?1 "
+        "ORDER BY bm25(task_search, 4.0, 1.0) LIMIT ?2",
+    [STMT_MAX_ID] = "SELECT max(id) FROM task",
+    [STMT_BEGIN] = "BEGIN IMMEDIATE",
+    [STMT_COMMIT] = "COMMIT",
+    [STMT_ROLLBACK] = "ROLLBACK",
+};
+
+static sqlite3_stmt* statements[STMT_COUNT];
+
+static DatabaseAccess requested_access = DB_ACCESS_READ_WRITE;
+
+#define TASK_MUTATION_POINTER "foo.TaskMutation"
+
 static void finalize_stmt(sqlite3_stmt* stmt) {
   if (stmt) sqlite3_finalize(stmt);
 }
 
-QueryStatus db_init() {
-  QueryStatus status = DB_ERR;
+static int prepare_stmt(const char* sql, int size, unsigned int flags,
+                        sqlite3_stmt** stmt) {
+  TIMING_PUSH(PHASE_PREPARE);
+  int rc = sqlite3_prepare_v3(db, sql, size, flags, stmt, NULL);
+  TIMING_POP();
+  return rc;
+}
 
-  if (db) {
-    status = DB_OK;
-    return status;
-  }
+/*
+ * Loops over many rows push PHASE_STEP once around the whole loop instead,
+ * so per-row visitors can nest their own phases without doubling the clock
+ * reads.
+ * */
+static int step_stmt(sqlite3_stmt* stmt) {
+  TIMING_PUSH(PHASE_STEP);
+  int rc = sqlite3_step(stmt);
+  TIMING_POP();
+  return rc;
+}
 
-  char* err;
-  const char* sql =
-      "CREATE TABLE IF NOT EXISTS task ("
-      "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-      "title VARCHAR(255) NOT NULL,"
-      "description VARCHAR(255),"
-      "finished BOOLEAN DEFAULT FALSE,"
-      "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP)";
-  sqlite3_stmt* stmt = NULL;
+/*
+ * Returns the cached statement for the given id, preparing it on first use
+ * and opening the connection if no statement has needed it yet.
+ * Statements live until db_close, so callers must hand them back with
+ * release_stmt instead of finalizing them.
+ * */
+static sqlite3_stmt* acquire_stmt(StatementId id) {
+  sqlite3_stmt* stmt = statements[id];
 
-  if (sqlite3_open("foo.db", &db) != SQLITE_OK) {
-    fprintf(stderr, "Failed to open the database: %s.\n", sqlite3_errmsg(db));
-    goto cleanup;
-  }
+  if (stmt) return stmt;
+  if (!db && db_init() != DB_OK) return NULL;
 
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+  if (prepare_stmt(statement_sql[id], -1, SQLITE_PREPARE_PERSISTENT, &stmt) !=
+      SQLITE_OK) {
     fprintf(stderr, "Failed to prepare SQLite statement: %s.\n",
             sqlite3_errmsg(db));
-    goto cleanup;
+    return NULL;
   }
 
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
-    fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
-            sqlite3_errmsg(db));
+  statements[id] = stmt;
+  return stmt;
+}
+
+/*
+ * Resets a cached statement so it drops its locks and can be rebound.
+ * */
+static void release_stmt(sqlite3_stmt* stmt) {
+  if (!stmt) return;
+
+  sqlite3_reset(stmt);
+  sqlite3_clear_bindings(stmt);
+}
+
+/*
+ * Which predicates a Filter turns on. Filters with the same shape produce the
+ * same SQL and differ only in bound values, so the shape is the cache key for
+ * prepared task queries.
+ * */
+enum {
+  SHAPE_DONE = 1 << 0,
+  SHAPE_PENDING = 1 << 1,
+  SHAPE_AFTER = 1 << 2,
+  SHAPE_BEFORE = 1 << 3,
+  SHAPE_LIMIT = 1 << 4,
+  SHAPES = 1 << 5
+};
+
+typedef enum {
+  TASK_QUERY_ROWS,
+  TASK_QUERY_PLAN,
+  TASK_QUERY_KINDS
+} TaskQueryKind;
+
+static const char* task_query_prefix[TASK_QUERY_KINDS] = {
+    [TASK_QUERY_ROWS] = "", [TASK_QUERY_PLAN] = "EXPLAIN QUERY PLAN "};
+
+static const char* task_query_suffix[TASK_QUERY_KINDS] = {
+    [TASK_QUERY_ROWS] = "", [TASK_QUERY_PLAN] = ""};
+
+static sqlite3_stmt* task_queries[TASK_QUERY_KINDS][SHAPES];
+
+/* Multi-row form of STMT_INSERT_TASK, see db_insert_tasks. */
+static sqlite3_stmt* insert_batch = NULL;
+
+static int filter_shape(Filter filter) {
+  return (filter.done ? SHAPE_DONE : 0) | (filter.pending ? SHAPE_PENDING : 0) |
+         (filter.after ? SHAPE_AFTER : 0) | (filter.before ? SHAPE_BEFORE : 0) |
+         (filter.limit ? SHAPE_LIMIT : 0);
+}
+
+static void finalize_statements() {
+  for (size_t i = 0; i < STMT_COUNT; ++i) {
+    finalize_stmt(statements[i]);
+    statements[i] = NULL;
+  }
+
+  for (size_t kind = 0; kind < TASK_QUERY_KINDS; ++kind) {
+    for (size_t shape = 0; shape < SHAPES; ++shape) {
+      finalize_stmt(task_queries[kind][shape]);
+      task_queries[kind][shape] = NULL;
+    }
+  }
+
+  finalize_stmt(insert_batch);
+  insert_batch = NULL;
+}
+
+/*
+ * SQL function task_transition(mutation, id, finished, new_finished).
+ * RETURNING only sees the new row, so UPDATEs call this from their SET clause
+ * to hand the prior state of each row to the bound TaskMutation.
+ * */
+static void task_transition(sqlite3_context* context, int argc,
+                            sqlite3_value** argv) {
+  (void)argc;
+  TaskMutation* mutation =
+      sqlite3_value_pointer(argv[0], TASK_MUTATION_POINTER);
+
+  if (mutation && mutation->changed) {
+    mutation->changed(sqlite3_value_int(argv[1]), sqlite3_value_int(argv[2]),
+                      mutation->context);
+  }
+
+  sqlite3_result_value(context, argv[3]);
+}
+
+void db_set_access(DatabaseAccess access) { requested_access = access; }
+
+static QueryStatus open_connection(sqlite3** connection, const char* path,
+                                   int flags) {
+  if (sqlite3_open_v2(path, connection, flags, NULL) != SQLITE_OK) goto cleanup;
+
+  profiler_attach(*connection);
+
+  if (tuning_apply(*connection) != DB_OK) goto cleanup;
+
+  if (sqlite3_create_function_v2(*connection, "task_transition", 4,
+                                 SQLITE_UTF8 | SQLITE_DIRECTONLY, NULL,
+                                 task_transition, NULL, NULL,
+                                 NULL) != SQLITE_OK) {
+    fprintf(stderr, "Failed to register SQL functions: %s.\n",
+            sqlite3_errmsg(*connection));
     goto cleanup;
   }
 
-  finalize_stmt(stmt);
+  return DB_OK;
+
+cleanup:
+  sqlite3_close(*connection);
+  *connection = NULL;
+  return DB_ERR;
+}
+
+static bool memory_mode() {
+  const char* mode = config_get("mode");
+  return mode && strcmp(mode, "memory") == 0;
+}
+
+/*
+ * Copies every page of source into destination with the online backup API.
+ * */
+static QueryStatus copy_database(sqlite3* destination, sqlite3* source) {
+  sqlite3_backup* backup =
+      sqlite3_backup_init(destination, "main", source, "main");
+
+  if (!backup) {
+    fprintf(stderr, "Failed to start database copy: %s.\n",
+            sqlite3_errmsg(destination));
+    return DB_ERR;
+  }
+
+  sqlite3_backup_step(backup, -1);
+
+  if (sqlite3_backup_finish(backup) != SQLITE_OK) {
+    fprintf(stderr, "Failed to copy database: %s.\n",
+            sqlite3_errmsg(destination));
+    return DB_ERR;
+  }
+
+  return DB_OK;
+}
+
+/*
+ * Takes the write lock on foo.db and keeps it until the connection closes,
+ * so no other process can commit to the file between loading it and the
+ * last snapshot; they get SQLITE_BUSY instead.
+ * */
+static QueryStatus lock_disk() {
+  char* err = NULL;
+
+  if (sqlite3_exec(disk,
+                   "PRAGMA locking_mode = EXCLUSIVE; BEGIN EXCLUSIVE; COMMIT",
+                   NULL, NULL, &err) != SQLITE_OK) {
+    fprintf(stderr, "Failed to lock foo.db for memory mode: %s.\n", err);
+    sqlite3_free(err);
+    return DB_ERR;
+  }
+
+  return DB_OK;
+}
+
+/*
+ * Writes the in-memory database back to foo.db when it changed since the
+ * last snapshot. Does nothing outside memory mode or inside a transaction.
+ * foo.db stays locked by lock_disk meanwhile, so the copy cannot discard
+ * another process's commits.
+ * */
+static QueryStatus snapshot() {
+  if (!disk || !sqlite3_get_autocommit(db)) return DB_OK;
+  if (sqlite3_total_changes64(db) == snapshot_changes) return DB_OK;
+
+  if (copy_database(disk, db) != DB_OK) return DB_ERR;
+
+  snapshot_changes = sqlite3_total_changes64(db);
+  return DB_OK;
+}
+
+/*
+ * Memory mode: foo.db is copied into a private in-memory database that
+ * serves every statement, and snapshot() copies it back at commit points
+ * and on close.
+ * */
+static QueryStatus open_in_memory() {
+  if (open_connection(&disk, "foo.db",
+                      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) != DB_OK) {
+    fprintf(stderr, "Failed to open the database: foo.db.\n");
+    return DB_ERR;
+  }
+
+  if (open_connection(&db, ":memory:",
+                      SQLITE_OPEN_READWRITE | SQLITE_OPEN_MEMORY) != DB_OK) {
+    fprintf(stderr, "Failed to open the in-memory database.\n");
+    return DB_ERR;
+  }
+
+  if (lock_disk() != DB_OK || copy_database(db, disk) != DB_OK)
+    return DB_ERR;
+
+  QueryStatus status = db_check_schema(db);
+
+  /* A new schema is not counted as a change; force the first snapshot. */
+  snapshot_changes = status == DB_NOT_FOUND ? -1 : sqlite3_total_changes64(db);
+
+  if (status == DB_NOT_FOUND) status = db_migrate(db);
 
-  status = DB_OK;
   return status;
+}
 
-cleanup:
-  finalize_stmt(stmt);
-  if (db) db = NULL;
+/*
+ * Creates or upgrades the schema of foo.db. The storage settings kept in the
+ * file are applied here, ahead of the migrations, rather than on every open.
+ * */
+static QueryStatus migrate() {
+  QueryStatus status = db_check_schema(db);
+
+  if (status != DB_NOT_FOUND) return status;
+  if (tuning_apply_storage(db) != DB_OK) return DB_ERR;
+
+  return db_migrate(db);
+}
+
+static void close_connections() {
+  sqlite3_close(db);
+  sqlite3_close(disk);
+  db = NULL;
+  disk = NULL;
+}
+
+/*
+ * Opens foo.db with the access requested through db_set_access, or loads it
+ * into memory when FOO_MODE / foo.conf selects "mode = memory". Read-only
+ * commands fall back to a read-write open when the file does not exist yet
+ * or its schema still needs migrating.
+ * */
+static QueryStatus open_database() {
+  QueryStatus status = DB_ERR;
+
+  if (memory_mode()) {
+    status = open_in_memory();
+    goto done;
+  }
+
+  if (requested_access == DB_ACCESS_READ_ONLY &&
+      open_connection(&db, "foo.db", SQLITE_OPEN_READONLY) == DB_OK) {
+    status = db_check_schema(db);
+    if (status != DB_NOT_FOUND) goto done;
+
+    sqlite3_close(db);
+    db = NULL;
+  }
+
+  if (open_connection(&db, "foo.db",
+                      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) != DB_OK) {
+    fprintf(stderr, "Failed to open the database: foo.db.\n");
+    return DB_ERR;
+  }
+
+  status = migrate();
+
+done:
+  if (status != DB_OK) close_connections();
   return status;
 }
 
-QueryStatus db_close() {
+QueryStatus db_init() {
+  if (db) return DB_OK;
+
+  TIMING_PUSH(PHASE_OPEN);
+  QueryStatus status = open_database();
+  TIMING_POP();
+
+  return status;
+}
+
+static QueryStatus close_database() {
   QueryStatus status = DB_ERR;
 
-  if (!db) {
-    status = DB_OK;
+  finalize_statements();
+
+  if (snapshot() != DB_OK) {
+    close_connections();
     return status;
   }
 
@@ -74,229 +400,619 @@ QueryStatus db_close() {
 
   db = NULL;
 
+  if (disk) sqlite3_close(disk);
+  disk = NULL;
+
   status = DB_OK;
   return status;
 }
 
-QueryStatus db_create_task(const Task* task) {
+QueryStatus db_close() {
+  if (!db) return DB_OK;
+
+  TIMING_PUSH(PHASE_CLOSE);
+  QueryStatus status = close_database();
+  TIMING_POP();
+
+  profiler_report();
+
+  return status;
+}
+
+static QueryStatus run_stmt(StatementId statement) {
   QueryStatus status = DB_ERR;
 
-  const char* sql =
-      "INSERT INTO task(title, description, finished) VALUES(?, ?, ?)";
-  sqlite3_stmt* stmt = NULL;
+  sqlite3_stmt* stmt = acquire_stmt(statement);
+  if (!stmt) return status;
 
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-    fprintf(stderr, "Failed to prepare SQLite statement: %s.\n",
+  if (step_stmt(stmt) != SQLITE_DONE) {
+    fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
             sqlite3_errmsg(db));
     goto cleanup;
   }
 
-  sqlite3_bind_text(stmt, 1, task->title, -1, SQLITE_TRANSIENT);
+  status = DB_OK;
+
+cleanup:
+  release_stmt(stmt);
+  return status;
+}
+
+QueryStatus db_begin() { return run_stmt(STMT_BEGIN); }
+
+QueryStatus db_commit() {
+  if (run_stmt(STMT_COMMIT) != DB_OK) return DB_ERR;
+  return snapshot();
+}
+
+/*
+ * Rolls back the open transaction, if any. Safe to call when none is open,
+ * e.g. by the server after every request so a command that failed half way
+ * cannot leak its transaction into the next one.
+ * */
+QueryStatus db_rollback() {
+  if (!db || sqlite3_get_autocommit(db)) return DB_OK;
+  return run_stmt(STMT_ROLLBACK);
+}
+
+/*
+ * Bulk inserts call these inside their transaction: the search index is left
+ * alone row by row and rebuilt once by db_resume_search before the commit.
+ * */
+QueryStatus db_suspend_search() {
+  if (!db || sqlite3_get_autocommit(db)) {
+    fprintf(stderr, "Search triggers can only be dropped in a transaction.\n");
+    return DB_ERR;
+  }
+
+  return db_drop_search_triggers(db);
+}
+
+QueryStatus db_resume_search() {
+  if (!db) return DB_ERR;
+  return db_restore_search(db);
+}
+
+QueryStatus db_create_task(const char* title, int* id) {
+  QueryStatus status = DB_ERR;
+
+  sqlite3_stmt* stmt = acquire_stmt(STMT_CREATE_TASK);
+  if (!stmt) return status;
+
+  sqlite3_bind_text(stmt, 1, title, -1, SQLITE_STATIC);
   sqlite3_bind_null(stmt, 2);
-  sqlite3_bind_int(stmt, 3, task->finished);
+  sqlite3_bind_int(stmt, 3, false);
 
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
+  if (step_stmt(stmt) != SQLITE_DONE) {
     fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
             sqlite3_errmsg(db));
     goto cleanup;
   }
 
-  finalize_stmt(stmt);
+  if (id) *id = (int)sqlite3_last_insert_rowid(db);
 
   status = DB_OK;
-  return status;
 
 cleanup:
-  finalize_stmt(stmt);
+  release_stmt(stmt);
   return status;
 }
 
-QueryStatus db_check_task(int id) {
-  QueryStatus status = DB_ERR;
+static void bind_record(sqlite3_stmt* stmt, int first,
+                        const TaskRecord* task) {
+  sqlite3_bind_text(stmt, first, task->title, -1, SQLITE_STATIC);
 
-  const char* sql = "UPDATE task SET finished = TRUE WHERE id = ?";
-  sqlite3_stmt* stmt = NULL;
+  if (task->description)
+    sqlite3_bind_text(stmt, first + 1, task->description, -1, SQLITE_STATIC);
+  else
+    sqlite3_bind_null(stmt, first + 1);
 
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+  sqlite3_bind_int(stmt, first + 2, task->finished);
+  sqlite3_bind_int64(stmt, first + 3, task->created_at);
+}
+
+/*
+ * Builds the multi-row INSERT used for full batches: STMT_INSERT_TASK with
+ * its VALUES tuple repeated DB_INSERT_BATCH times.
+ * */
+static sqlite3_stmt* acquire_insert_batch() {
+  if (insert_batch) return insert_batch;
+  if (!db && db_init() != DB_OK) return NULL;
+
+  QueryBuilder qb;
+
+  if (qb_init(&qb) != QB_OK) return NULL;
+
+  int rc = qb_clause(&qb, INSERT_TASK_SQL);
+
+  for (int i = 0; i < DB_INSERT_BATCH && rc == QB_OK; ++i) {
+    if (i > 0) rc = qb_clause(&qb, ", ");
+    if (rc == QB_OK) rc = qb_clause(&qb, INSERT_TASK_VALUES);
+  }
+
+  if (rc == QB_OK &&
+      prepare_stmt(qb.sql, qb.size + 1, SQLITE_PREPARE_PERSISTENT,
+                   &insert_batch) != SQLITE_OK) {
     fprintf(stderr, "Failed to prepare SQLite statement: %s.\n",
             sqlite3_errmsg(db));
-    goto cleanup;
+    insert_batch = NULL;
   }
 
-  sqlite3_bind_int(stmt, 1, id);
+  qb_destroy(&qb);
+  return insert_batch;
+}
+
+static QueryStatus step_insert(sqlite3_stmt* stmt) {
+  int rc = step_stmt(stmt);
 
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
+  release_stmt(stmt);
+
+  if (rc != SQLITE_DONE) {
     fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
             sqlite3_errmsg(db));
-    goto cleanup;
+    return DB_ERR;
   }
 
-  finalize_stmt(stmt);
+  return DB_OK;
+}
 
-  status = DB_OK;
-  return status;
+/*
+ * Inserts fully specified tasks, for bulk loads that set every column.
+ * Rows go in DB_INSERT_BATCH at a time through one multi-row INSERT: the
+ * full-text index flushes its pending terms once per statement, so one
+ * statement per row would spend most of its time in that flush. The rest go
+ * through the single-row statement. last_id receives the id of the last row.
+ * */
+QueryStatus db_insert_tasks(const TaskRecord* tasks, size_t count,
+                            int* last_id) {
+  size_t i = 0;
+
+  for (; i + DB_INSERT_BATCH <= count; i += DB_INSERT_BATCH) {
+    sqlite3_stmt* stmt = acquire_insert_batch();
+    if (!stmt) return DB_ERR;
+
+    for (int row = 0; row < DB_INSERT_BATCH; ++row)
+      bind_record(stmt, row * 4 + 1, &tasks[i + row]);
+
+    if (step_insert(stmt) != DB_OK) return DB_ERR;
+  }
 
-cleanup:
-  finalize_stmt(stmt);
-  return status;
+  for (; i < count; ++i) {
+    sqlite3_stmt* stmt = acquire_stmt(STMT_INSERT_TASK);
+    if (!stmt) return DB_ERR;
+
+    bind_record(stmt, 1, &tasks[i]);
+
+    if (step_insert(stmt) != DB_OK) return DB_ERR;
+  }
+
+  if (last_id) *last_id = (int)sqlite3_last_insert_rowid(db);
+
+  return DB_OK;
 }
 
-QueryStatus db_uncheck_task(int id) {
+/*
+ * Runs a set-based mutation over [first_id, last_id]. Every touched row is
+ * reported with its prior state, either through task_transition or through
+ * the statement's RETURNING rows, and the number of rows is stored in
+ * mutation->changes.
+ * */
+static QueryStatus run_range_stmt(StatementId statement, int first_id,
+                                  int last_id, TaskMutation* mutation) {
   QueryStatus status = DB_ERR;
 
-  const char* sql = "UPDATE task SET finished = FALSE WHERE id = ?";
-  sqlite3_stmt* stmt = NULL;
+  sqlite3_stmt* stmt = acquire_stmt(statement);
+  if (!stmt) return status;
 
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-    fprintf(stderr, "Failed to prepare SQLite statement: %s\n",
-            sqlite3_errmsg(db));
-    goto cleanup;
+  sqlite3_bind_int(stmt, 1, first_id);
+  sqlite3_bind_int(stmt, 2, last_id);
+
+  if (sqlite3_bind_parameter_count(stmt) == 3)
+    sqlite3_bind_pointer(stmt, 3, mutation, TASK_MUTATION_POINTER, NULL);
+
+  int rc;
+
+  TIMING_PUSH(PHASE_STEP);
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    if (mutation->changed) {
+      mutation->changed(sqlite3_column_int(stmt, 0),
+                        sqlite3_column_int(stmt, 1), mutation->context);
+    }
   }
 
-  sqlite3_bind_int(stmt, 1, id);
+  TIMING_POP();
 
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
-    fprintf(stderr, "Failed to step through SQLite statement: %s\n",
+  if (rc != SQLITE_DONE) {
+    fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
             sqlite3_errmsg(db));
     goto cleanup;
   }
 
-  finalize_stmt(stmt);
-
+  mutation->changes = sqlite3_changes(db);
   status = DB_OK;
-  return status;
 
 cleanup:
-  finalize_stmt(stmt);
+  release_stmt(stmt);
   return status;
 }
 
-QueryStatus db_list_task(int id, Task* task) {
-  QueryStatus status = DB_ERR;
+QueryStatus db_check_tasks(int first_id, int last_id, TaskMutation* mutation) {
+  return run_range_stmt(STMT_CHECK_TASKS, first_id, last_id, mutation);
+}
 
-  const char* sql = "SELECT * FROM task WHERE id = ?";
-  sqlite3_stmt* stmt = NULL;
+QueryStatus db_uncheck_tasks(int first_id, int last_id,
+                             TaskMutation* mutation) {
+  return run_range_stmt(STMT_UNCHECK_TASKS, first_id, last_id, mutation);
+}
 
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-    fprintf(stderr, "Failed to prepare SQLite statement: %s\n",
-            sqlite3_errmsg(db));
-    goto cleanup;
+QueryStatus db_delete_tasks(int first_id, int last_id,
+                            TaskMutation* mutation) {
+  return run_range_stmt(STMT_DELETE_TASKS, first_id, last_id, mutation);
+}
+
+/*
+ * Builds the task query for a filter, optionally wrapped in a prefix and
+ * suffix such as EXPLAIN QUERY PLAN. The builder records the value of every
+ * placeholder as it is appended, so the SQL and its bindings cannot
+ * disagree.
+ * Only the columns the listing prints are selected so the task_pending
+ * partial index covers pending listings.
+ * */
+static int build_task_query(QueryBuilder* qb, Filter filter,
+                            TaskQueryKind kind) {
+  int rc;
+
+  /* A limited --before page reads backwards, then restores id order. */
+  bool backwards = filter.before && filter.limit && !filter.after;
+
+  if ((rc = qb_clause(qb, task_query_prefix[kind])) != QB_OK) return rc;
+
+  if (backwards) {
+    if ((rc = qb_clause(qb, "SELECT * FROM (")) != QB_OK) return rc;
   }
 
-  sqlite3_bind_int(stmt, 1, id);
+  if ((rc = qb_clause(qb, "SELECT id, title, finished FROM task")) != QB_OK)
+    return rc;
 
-  int rc = sqlite3_step(stmt);
+  if (filter.done) {
+    if ((rc = qb_where(qb, "finished = TRUE")) != QB_OK) return rc;
+  }
 
-  if (rc == SQLITE_DONE) {
-    finalize_stmt(stmt);
-    status = DB_NOT_FOUND;
-    return status;
+  if (filter.pending) {
+    if ((rc = qb_where(qb, "finished = FALSE")) != QB_OK) return rc;
   }
 
-  if (rc == SQLITE_ROW) {
-    task->id = sqlite3_column_int(stmt, 0);
-    snprintf(task->title, TASK_TITLE_SIZE, "%s",
-             (char*)sqlite3_column_text(stmt, 1));
-    task->finished = sqlite3_column_int(stmt, 3);
+  if (filter.after) {
+    if ((rc = qb_where_int(qb, "id > ?", filter.after)) != QB_OK) return rc;
+  }
 
-    finalize_stmt(stmt);
+  if (filter.before) {
+    if ((rc = qb_where_int(qb, "id < ?", filter.before)) != QB_OK) return rc;
+  }
 
-    status = DB_OK;
-    return status;
+  rc = qb_clause(qb, backwards ? " ORDER BY id DESC" : " ORDER BY id");
+  if (rc != QB_OK) return rc;
+
+  if (filter.limit) {
+    if ((rc = qb_clause_int(qb, " LIMIT ?", filter.limit)) != QB_OK)
+      return rc;
   }
 
-  fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
-          sqlite3_errmsg(db));
-  goto cleanup;
+  if (backwards) {
+    if ((rc = qb_clause(qb, ") ORDER BY id")) != QB_OK) return rc;
+  }
 
-cleanup:
-  finalize_stmt(stmt);
-  return status;
+  return qb_clause(qb, task_query_suffix[kind]);
 }
 
-QueryStatus db_list_tasks(List* tasks, Filter filter) {
-  QueryStatus status = DB_ERR;
-  QueryBuilder qb;
+/*
+ * Binds the values the builder recorded, in placeholder order.
+ * */
+static QueryStatus bind_params(sqlite3_stmt* stmt, const QueryBuilder* qb) {
+  for (size_t i = 0; i < qb->param_count; ++i) {
+    if (sqlite3_bind_int64(stmt, i + 1, qb->params[i]) != SQLITE_OK) {
+      fprintf(stderr, "Failed to bind SQLite parameter: %s.\n",
+              sqlite3_errmsg(db));
+      return DB_ERR;
+    }
+  }
 
-  if (qb_init(&qb) != QB_OK) goto cleanup;
-  if (qb_clause(&qb, "SELECT * FROM task ") != QB_OK) goto cleanup;
+  return DB_OK;
+}
 
+/*
+ * Returns the task query for the filter with the filter's values bound. The
+ * SQL is rebuilt on every call, which is cheap, but only prepared the first
+ * time its shape is seen. Like acquire_stmt, the statement must be handed
+ * back with release_stmt.
+ * */
+static QueryStatus prepare_task_query(Filter filter, TaskQueryKind kind,
+                                      sqlite3_stmt** stmt) {
   if (filter.done && filter.pending) {
     fprintf(stderr, "Cannot filter by done and pending at the same time.\n");
-    goto cleanup;
+    return DB_ERR;
   }
 
-  if (filter.done) {
-    if (qb_clause(&qb, "WHERE finished = TRUE") != QB_OK) goto cleanup;
-  }
+  if (!db && db_init() != DB_OK) return DB_ERR;
 
-  if (filter.pending) {
-    if (qb_clause(&qb, "WHERE finished = FALSE") != QB_OK) goto cleanup;
+  QueryStatus status = DB_ERR;
+  QueryBuilder qb;
+
+  if (qb_init(&qb) != QB_OK) return DB_ERR;
+  if (build_task_query(&qb, filter, kind) != QB_OK) goto cleanup;
+
+  int shape = filter_shape(filter);
+
+  if (!task_queries[kind][shape]) {
+    if (prepare_stmt(qb.sql, qb.size + 1, SQLITE_PREPARE_PERSISTENT,
+                     &task_queries[kind][shape]) != SQLITE_OK) {
+      fprintf(stderr, "Failed to prepare SQLite statement: %s.\n",
+              sqlite3_errmsg(db));
+      task_queries[kind][shape] = NULL;
+      goto cleanup;
+    }
   }
 
-  sqlite3_stmt* stmt = NULL;
+  *stmt = task_queries[kind][shape];
 
-  if (sqlite3_prepare_v2(db, qb.sql, -1, &stmt, NULL) != SQLITE_OK) {
-    fprintf(stderr, "Failed to prepare SQLite statement: %s.\n",
-            sqlite3_errmsg(db));
+  if (bind_params(*stmt, &qb) != DB_OK) {
+    release_stmt(*stmt);
     goto cleanup;
   }
 
+  status = DB_OK;
+
+cleanup:
+  qb_destroy(&qb);
+  return status;
+}
+
+/*
+ * Steps the filtered task query and hands each row to the visitor as soon as
+ * it is read. The title is only valid during the callback; returning false
+ * stops the iteration early.
+ * */
+QueryStatus db_each_task(Filter filter, TaskVisitor visit, void* context) {
+  QueryStatus status = DB_ERR;
+  sqlite3_stmt* stmt = NULL;
+
+  if (prepare_task_query(filter, TASK_QUERY_ROWS, &stmt) != DB_OK) goto cleanup;
+
   int rc;
 
+  TIMING_PUSH(PHASE_STEP);
+
   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
     int id = sqlite3_column_int(stmt, 0);
+    const char* title = (const char*)sqlite3_column_text(stmt, 1);
+    bool finished = sqlite3_column_int(stmt, 2);
 
-    char title[TASK_TITLE_SIZE] = "";
-    strncpy(title, (char*)sqlite3_column_text(stmt, 1), TASK_TITLE_SIZE);
+    if (!visit(id, title ? title : "", finished, context)) {
+      rc = SQLITE_DONE;
+      break;
+    }
+  }
 
-    bool finished = sqlite3_column_int(stmt, 3);
+  TIMING_POP();
 
-    add_to_list(tasks, id, title, finished);
+  if (rc != SQLITE_DONE) {
+    fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
+            sqlite3_errmsg(db));
+    goto cleanup;
   }
 
+  status = DB_OK;
+
+cleanup:
+  release_stmt(stmt);
+  return status;
+}
+
+/*
+ * Reports the query plan SQLite picks for the filtered task query, one
+ * EXPLAIN QUERY PLAN detail line per callback.
+ * */
+QueryStatus db_explain_tasks(Filter filter, PlanVisitor visit,
+                             void* context) {
+  QueryStatus status = DB_ERR;
+  sqlite3_stmt* stmt = NULL;
+
+  if (prepare_task_query(filter, TASK_QUERY_PLAN, &stmt) != DB_OK)
+    goto cleanup;
+
+  int rc;
+
+  TIMING_PUSH(PHASE_STEP);
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    visit((const char*)sqlite3_column_text(stmt, 3), context);
+  }
+
+  TIMING_POP();
+
   if (rc != SQLITE_DONE) {
     fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
             sqlite3_errmsg(db));
     goto cleanup;
   }
 
-  finalize_stmt(stmt);
-  qb_destroy(&qb);
-
   status = DB_OK;
-  return status;
 
 cleanup:
-  finalize_stmt(stmt);
-  qb_destroy(&qb);
+  release_stmt(stmt);
   return status;
 }
 
-QueryStatus db_delete_task(int id) {
+/*
+ * Runs an FTS5 query over titles and descriptions, best bm25 match first
+ * with titles weighted above descriptions. The visitor receives a snippet of
+ * the matching text, with matched terms wrapped in '*', instead of the
+ * title. A limit of 0 returns every match.
+ * */
+QueryStatus db_search_tasks(const char* query, int limit, TaskVisitor visit,
+                            void* context) {
   QueryStatus status = DB_ERR;
 
-  const char* sql = "DELETE FROM task WHERE id = ?";
-  sqlite3_stmt* stmt = NULL;
+  sqlite3_stmt* stmt = acquire_stmt(STMT_SEARCH_TASKS);
+  if (!stmt) return status;
 
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-    fprintf(stderr, "Failed to prepare SQLite statement: %s\n",
-            sqlite3_errmsg(db));
+  sqlite3_bind_text(stmt, 1, query, -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 2, limit ? limit : -1);
+
+  int rc;
+
+  TIMING_PUSH(PHASE_STEP);
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const char* snippet = (const char*)sqlite3_column_text(stmt, 1);
+
+    if (!visit(sqlite3_column_int(stmt, 0), snippet ? snippet : "",
+               sqlite3_column_int(stmt, 2), context)) {
+      rc = SQLITE_DONE;
+      break;
+    }
+  }
+
+  TIMING_POP();
+
+  if (rc != SQLITE_DONE) {
+    fprintf(stderr, "Failed to search tasks: %s.\n", sqlite3_errmsg(db));
     goto cleanup;
   }
 
-  sqlite3_bind_int(stmt, 1, id);
+  status = DB_OK;
+
+cleanup:
+  release_stmt(stmt);
+  return status;
+}
+
+/*
+ * Estimates how many rows the filter returns without scanning them: the id
+ * range it covers, capped by its limit. ids are dense unless tasks were
+ * deleted, so this is close for listings without a status filter. With one,
+ * the share of matching rows is unknown, so only an explicit limit is
+ * trusted and the columns otherwise grow as rows arrive.
+ * */
+static QueryStatus estimate_tasks(Filter filter, size_t* count) {
+  if (filter.done || filter.pending) {
+    *count = filter.limit;
+    return DB_OK;
+  }
+
+  QueryStatus status = DB_ERR;
+  sqlite3_stmt* stmt = acquire_stmt(STMT_MAX_ID);
+
+  if (!stmt) goto cleanup;
 
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
+  if (step_stmt(stmt) != SQLITE_ROW) {
     fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
             sqlite3_errmsg(db));
     goto cleanup;
   }
 
-  finalize_stmt(stmt);
+  long long last = sqlite3_column_int64(stmt, 0);
+
+  if (filter.before && filter.before <= last) last = filter.before - 1;
+
+  *count = last > filter.after ? last - filter.after : 0;
+
+  if (filter.limit && (size_t)filter.limit < *count) *count = filter.limit;
 
   status = DB_OK;
+
+cleanup:
+  release_stmt(stmt);
   return status;
+}
+
+static bool append_column(int id, const char* title, bool finished,
+                          void* context) {
+  TIMING_PUSH(PHASE_MATERIALIZE);
+  add_to_columns(context, id, title, finished);
+  TIMING_POP();
+  return true;
+}
+
+/*
+ * Appends the filtered tasks to the columns, reserving room for an estimate
+ * of the row count up front; the arrays still grow if it falls short.
+ * */
+QueryStatus db_list_columns(TaskColumns* columns, Filter filter) {
+  size_t count;
+
+  if (estimate_tasks(filter, &count) != DB_OK) return DB_ERR;
+
+  reserve_columns(columns, columns->size + count);
+
+  return db_each_task(filter, append_column, columns);
+}
+
+static const char* setting_name(const char* pragma, int value) {
+  static const char* synchronous[] = {"OFF", "NORMAL", "FULL", "EXTRA"};
+  static const char* temp_store[] = {"DEFAULT", "FILE", "MEMORY"};
+
+  if (strcmp(pragma, "synchronous") == 0 && value >= 0 && value < 4)
+    return synchronous[value];
+
+  if (strcmp(pragma, "temp_store") == 0 && value >= 0 && value < 3)
+    return temp_store[value];
+
+  return NULL;
+}
+
+/*
+ * Reports the active tuning profile followed by the storage settings the
+ * connection actually runs with.
+ * */
+QueryStatus db_info(SettingVisitor visit, void* context) {
+  static const char* pragmas[] = {"journal_mode", "synchronous", "mmap_size",
+                                  "cache_size",   "temp_store",  "page_size",
+                                  "page_count",   "user_version"};
+
+  QueryStatus status = DB_ERR;
+  sqlite3_stmt* stmt = NULL;
+
+  if (!db && db_init() != DB_OK) return status;
+
+  visit("mode", disk ? "memory" : "disk", context);
+  visit("profile", tuning_profile()->name, context);
+
+  for (size_t i = 0; i < sizeof(pragmas) / sizeof(pragmas[0]); ++i) {
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA %s", pragmas[i]);
+
+    if (prepare_stmt(sql, -1, 0, &stmt) != SQLITE_OK) {
+      fprintf(stderr, "Failed to prepare SQLite statement: %s.\n",
+              sqlite3_errmsg(db));
+      goto cleanup;
+    }
+
+    int rc = step_stmt(stmt);
+
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+      fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
+              sqlite3_errmsg(db));
+      goto cleanup;
+    }
+
+    /* Some settings, like mmap_size, do not apply to in-memory databases. */
+    if (rc == SQLITE_DONE) {
+      finalize_stmt(stmt);
+      stmt = NULL;
+      continue;
+    }
+
+    const char* name = setting_name(pragmas[i], sqlite3_column_int(stmt, 0));
+    visit(pragmas[i], name ? name : (const char*)sqlite3_column_text(stmt, 0),
+          context);
+
+    finalize_stmt(stmt);
+    stmt = NULL;
+  }
+
+  status = DB_OK;
 
 cleanup:
   finalize_stmt(stmt);
@@ -9,18 +9,69 @@ typedef enum {
   DB_ERR,
 } QueryStatus;
 
+typedef enum {
+  DB_ACCESS_READ_ONLY,
+  DB_ACCESS_READ_WRITE,
+} DatabaseAccess;
+
 typedef struct {
   bool done;
   bool pending;
+  int limit;
+  int after;
+  int before;
 } Filter;
 
+#define DB_INSERT_BATCH 256
+
+/*
+ * Every column of a task, for bulk inserts. created_at is a Unix timestamp
+ * and description may be NULL.
+ * */
+typedef struct {
+  const char* title;
+  const char* description;
+  bool finished;
+  long long created_at;
+} TaskRecord;
+
+typedef bool (*TaskVisitor)(int id, const char* title, bool finished,
+                            void* context);
+
+typedef void (*PlanVisitor)(const char* detail, void* context);
+
+typedef void (*SettingVisitor)(const char* name, const char* value,
+                               void* context);
+
+typedef void (*TaskChangeCallback)(int id, bool was_finished, void* context);
+
+typedef struct {
+  TaskChangeCallback changed;
+  void* context;
+  int changes;
+} TaskMutation;
+
+void db_set_access(DatabaseAccess access);
 QueryStatus db_init();
 QueryStatus db_close();
-QueryStatus db_create_task(const Task* task);
-QueryStatus db_list_task(int id, Task* task);
-QueryStatus db_list_tasks(List* tasks, Filter filter);
-QueryStatus db_check_task(int id);
-QueryStatus db_uncheck_task(int id);
-QueryStatus db_delete_task(int id);
+QueryStatus db_begin();
+QueryStatus db_commit();
+QueryStatus db_rollback();
+QueryStatus db_suspend_search();
+QueryStatus db_resume_search();
+QueryStatus db_create_task(const char* title, int* id);
+QueryStatus db_insert_tasks(const TaskRecord* tasks, size_t count,
+                            int* last_id);
+QueryStatus db_list_columns(TaskColumns* columns, Filter filter);
+QueryStatus db_each_task(Filter filter, TaskVisitor visit, void* context);
+QueryStatus db_search_tasks(const char* query, int limit, TaskVisitor visit,
+                            void* context);
+QueryStatus db_explain_tasks(Filter filter, PlanVisitor visit, void* context);
+QueryStatus db_info(SettingVisitor visit, void* context);
+QueryStatus db_check_tasks(int first_id, int last_id, TaskMutation* mutation);
+QueryStatus db_uncheck_tasks(int first_id, int last_id,
+                             TaskMutation* mutation);
+QueryStatus db_delete_tasks(int first_id, int last_id,
+                            TaskMutation* mutation);
 
 #endif
@@ -0,0 +1,154 @@
+#include "generator.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define GEN_EPOCH 1704067200 /* 2024-01-01 00:00:00 UTC */
+#define GEN_TEXT_MAX 256
+
+typedef struct {
+  int percent;
+  int min_length;
+  int max_length;
+} LengthBucket;
+
+/*
+ * Title and description lengths are drawn from these histograms. Most
+ * titles are short, with a tail up to the 255 characters the schema allows;
+ * most tasks have no description at all (a 0 length bucket).
+ * */
+static const LengthBucket title_lengths[] = {
+    {30, 8, 16}, {40, 16, 32}, {20, 32, 64}, {8, 64, 128}, {2, 128, 255},
+};
+
+static const LengthBucket description_lengths[] = {
+    {60, 0, 0},
+    {25, 16, 64},
+    {15, 64, 255},
+};
+
+static const char* words[] = {
+    "fix",     "review", "deploy",   "write",   "update",  "release",
+    "test",    "plan",   "call",     "email",   "report",  "budget",
+    "server",  "login",  "database", "backup",  "meeting", "design",
+    "invoice", "draft",  "migrate",  "refactor", "notes",  "schedule",
+    "client",  "team",   "weekly",   "staging", "docs",    "cleanup",
+    "monitor", "alert",
+};
+
+static const size_t words_count = sizeof(words) / sizeof(const char*);
+
+/*
+ * splitmix64: small, fast and good enough for synthetic data, and unlike
+ * rand() identical on every platform.
+ * */
+static uint64_t next_random(uint64_t* state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static int random_between(uint64_t* state, int min, int max) {
+  return min + (int)(next_random(state) % (uint64_t)(max - min + 1));
+}
+
+static int random_length(uint64_t* state, const LengthBucket* buckets,
+                         size_t count) {
+  int roll = random_between(state, 0, 99);
+
+  for (size_t i = 0; i < count; ++i) {
+    if (roll < buckets[i].percent)
+      return random_between(state, buckets[i].min_length,
+                            buckets[i].max_length);
+
+    roll -= buckets[i].percent;
+  }
+
+  return buckets[count - 1].max_length;
+}
+
+/*
+ * Fills text with words up to exactly length characters; the last word is
+ * cut short if it does not fit.
+ * */
+static void random_text(uint64_t* state, char* text, int length) {
+  int size = 0;
+
+  while (size < length) {
+    const char* word = words[next_random(state) % words_count];
+    int word_size = strlen(word);
+
+    if (size > 0) text[size++] = ' ';
+    if (word_size > length - size) word_size = length - size;
+
+    memcpy(text + size, word, word_size);
+    size += word_size;
+  }
+
+  text[length] = '\0';
+
+  if (length > 0 && text[length - 1] == ' ') text[length - 1] = 'x';
+}
+
+/*
+ * Inserts options->count tasks DB_INSERT_BATCH at a time in one transaction.
+ * The search triggers are dropped meanwhile and task_search is rebuilt once
+ * before the commit, which is much cheaper than indexing row by row.
+ * created_at grows with the id across options->days, with up to an hour of
+ * jitter.
+ * */
+QueryStatus generate_tasks(const GeneratorOptions* options, int* first_id,
+                           int* last_id) {
+  static char titles[DB_INSERT_BATCH][GEN_TEXT_MAX];
+  static char descriptions[DB_INSERT_BATCH][GEN_TEXT_MAX];
+  TaskRecord batch[DB_INSERT_BATCH];
+  uint64_t state = options->seed;
+  double span = (double)options->days * 86400;
+  size_t done = 0;
+
+  *first_id = 0;
+  *last_id = 0;
+
+  if (db_begin() != DB_OK) return DB_ERR;
+  if (db_suspend_search() != DB_OK) goto rollback;
+
+  while (done < options->count) {
+    size_t size = 0;
+
+    for (; size < DB_INSERT_BATCH && done < options->count; ++size, ++done) {
+      TaskRecord* task = &batch[size];
+
+      random_text(&state, titles[size],
+                  random_length(&state, title_lengths,
+                                sizeof(title_lengths) / sizeof(LengthBucket)));
+
+      int description_length =
+          random_length(&state, description_lengths,
+                        sizeof(description_lengths) / sizeof(LengthBucket));
+
+      random_text(&state, descriptions[size], description_length);
+
+      task->title = titles[size];
+      task->description = description_length ? descriptions[size] : NULL;
+      task->finished = random_between(&state, 0, 99) < options->done_percent;
+      task->created_at = GEN_EPOCH +
+                         (long long)(span * done / options->count) +
+                         random_between(&state, 0, 3599);
+    }
+
+    if (db_insert_tasks(batch, size, last_id) != DB_OK) goto rollback;
+
+    if (*first_id == 0) *first_id = *last_id - (int)size + 1;
+  }
+
+  if (db_resume_search() != DB_OK) goto rollback;
+  if (db_commit() != DB_OK) goto rollback;
+
+  return DB_OK;
+
+rollback:
+  db_rollback();
+  return DB_ERR;
+}
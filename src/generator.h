@@ -0,0 +1,27 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "database.h"
+
+#define GEN_DEFAULT_SEED 1
+#define GEN_DEFAULT_DONE_PERCENT 30
+#define GEN_DEFAULT_DAYS 365
+
+/*
+ * Shape of a synthetic dataset. The same options always produce the same
+ * rows, so databases built from them can be compared across runs.
+ * */
+typedef struct {
+  size_t count;
+  uint64_t seed;
+  int done_percent;
+  int days;
+} GeneratorOptions;
+
+QueryStatus generate_tasks(const GeneratorOptions* options, int* first_id,
+                           int* last_id);
+
+#endif
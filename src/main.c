@@ -1,12 +1,67 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "command.h"
 #include "database.h"
+#include "profiler.h"
+#include "server.h"
+#include "timing.h"
+
+static ProfileFormat profile_from(const char* format) {
+  if (!format || !*format || strcmp(format, "0") == 0) return PROFILE_OFF;
+  return strcmp(format, "json") == 0 ? PROFILE_JSON : PROFILE_TABLE;
+}
+
+/*
+ * Removes the global flags, which may appear anywhere on the command line,
+ * and applies them together with their environment variables. Returns the
+ * remaining argc.
+ * */
+static int apply_global_flags(int argc, const char** argv) {
+  const char* env = getenv("FOO_TIMING");
+  bool timing = env && *env && strcmp(env, "0") != 0;
+  ProfileFormat profile = profile_from(getenv("FOO_PROFILE"));
+  int kept = 1;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--timing") == 0) {
+      timing = true;
+      continue;
+    }
+
+    if (strcmp(argv[i], "--profile") == 0 ||
+        strncmp(argv[i], "--profile=", 10) == 0) {
+      profile = argv[i][9] ? profile_from(argv[i] + 10) : PROFILE_TABLE;
+      continue;
+    }
+
+    argv[kept++] = argv[i];
+  }
+
+  argv[kept] = NULL;
+
+  if (timing) timing_start();
+  profiler_start(profile);
+
+  return kept;
+}
 
 int main(int argc, const char** argv) {
-  db_init();
-  int rc = run_command(argc, argv);
+  int rc;
+
+  argc = apply_global_flags(argc, argv);
+
+  /* Measured runs stay in this process so the numbers describe it. */
+  if (!timing_enabled && profile_format == PROFILE_OFF &&
+      server_forward(argc, argv, &rc))
+    return rc;
+
+  rc = run_command(argc, argv);
   db_close();
+
+  if (timing_enabled) timing_report();
+
   return rc;
 }
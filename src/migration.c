@@ -0,0 +1,179 @@
+#include "migration.h"
+
+#include <stdio.h>
+
+typedef struct {
+  const char* name;
+  const char* sql;
+} Migration;
+
+/*
+ * The triggers keeping task_search in step with task. Migration 3 creates
+ * them; db_drop_search_triggers and db_restore_search take them down and
+ * back up around bulk inserts.
+ * */
+#define SEARCH_TRIGGERS_SQL                                                  \
+  "CREATE TRIGGER IF NOT EXISTS task_search_insert "                         \
+  "AFTER INSERT ON task BEGIN "                                              \
+  "INSERT INTO task_search(rowid, title, description) "                      \
+  "VALUES (new.id, new.title, new.description); END;"                        \
+  "CREATE TRIGGER IF NOT EXISTS task_search_delete "                         \
+  "AFTER DELETE ON task BEGIN "                                              \
+  "INSERT INTO task_search(task_search, rowid, title, description) "         \
+  "VALUES ('delete', old.id, old.title, old.description); END;"              \
+  "CREATE TRIGGER IF NOT EXISTS task_search_update "                         \
+  "AFTER UPDATE OF title, description ON task BEGIN "                        \
+  "INSERT INTO task_search(task_search, rowid, title, description) "         \
+  "VALUES ('delete', old.id, old.title, old.description);"                   \
+  "INSERT INTO task_search(rowid, title, description) "                      \
+  "VALUES (new.id, new.title, new.description); END;"
+
+#define SEARCH_REBUILD_SQL \
+  "INSERT INTO task_search(task_search) VALUES ('rebuild')"
+
+/*
+ * Ordered schema history. PRAGMA user_version stores how many of these have
+ * been applied, so new entries must only ever be appended.
+ * */
+static const Migration migrations[] = {
+    {.name = "create task table",
+     .sql = "CREATE TABLE IF NOT EXISTS task ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+            "title VARCHAR(255) NOT NULL,"
+            "description VARCHAR(255),"
+            "finished BOOLEAN DEFAULT FALSE,"
+            "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP)"},
+    {.name = "index pending tasks",
+     .sql = "CREATE INDEX IF NOT EXISTS task_pending "
+            "ON task(id, title, finished) WHERE finished = FALSE"},
+    {.name = "index task text",
+     .sql = "CREATE VIRTUAL TABLE IF NOT EXISTS task_search USING fts5("
+            "title, description, content = 'task', content_rowid = 'id',"
+            "tokenize = 'unicode61 remove_diacritics 2', prefix = '2 3');"
+            SEARCH_TRIGGERS_SQL
+            SEARCH_REBUILD_SQL},
+};
+
+static const int migrations_count = sizeof(migrations) / sizeof(Migration);
+
+static QueryStatus read_version(sqlite3* db, int* version) {
+  QueryStatus status = DB_ERR;
+  sqlite3_stmt* stmt = NULL;
+
+  if (sqlite3_prepare_v2(db, "PRAGMA user_version", -1, &stmt, NULL) !=
+      SQLITE_OK) {
+    fprintf(stderr, "Failed to prepare SQLite statement: %s.\n",
+            sqlite3_errmsg(db));
+    goto cleanup;
+  }
+
+  if (sqlite3_step(stmt) != SQLITE_ROW) {
+    fprintf(stderr, "Failed to step through SQLite statement: %s.\n",
+            sqlite3_errmsg(db));
+    goto cleanup;
+  }
+
+  *version = sqlite3_column_int(stmt, 0);
+  status = DB_OK;
+
+cleanup:
+  sqlite3_finalize(stmt);
+  return status;
+}
+
+static QueryStatus exec(sqlite3* db, const char* sql) {
+  char* err = NULL;
+
+  if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+    fprintf(stderr, "Failed to execute SQL: %s.\n", err);
+    sqlite3_free(err);
+    return DB_ERR;
+  }
+
+  return DB_OK;
+}
+
+/*
+ * Applies every migration past the stored user_version in one transaction.
+ * The version is read again after taking the write lock so concurrent
+ * invocations do not apply the same migration twice.
+ * */
+static QueryStatus apply_migrations(sqlite3* db) {
+  int version;
+
+  if (exec(db, "BEGIN IMMEDIATE") != DB_OK) return DB_ERR;
+  if (read_version(db, &version) != DB_OK) goto rollback;
+
+  for (int i = version; i < migrations_count; ++i) {
+    if (exec(db, migrations[i].sql) != DB_OK) {
+      fprintf(stderr, "Migration %d (%s) failed.\n", i + 1,
+              migrations[i].name);
+      goto rollback;
+    }
+  }
+
+  char sql[32];
+  snprintf(sql, sizeof(sql), "PRAGMA user_version = %d", migrations_count);
+
+  if (exec(db, sql) != DB_OK) goto rollback;
+  if (exec(db, "COMMIT") != DB_OK) goto rollback;
+
+  return DB_OK;
+
+rollback:
+  exec(db, "ROLLBACK");
+  return DB_ERR;
+}
+
+/*
+ * Returns DB_OK when the schema is current and DB_NOT_FOUND when migrations
+ * are pending. Only reads user_version, so it works on read-only connections.
+ * */
+QueryStatus db_check_schema(sqlite3* db) {
+  int version;
+
+  if (read_version(db, &version) != DB_OK) return DB_ERR;
+
+  if (version == migrations_count) return DB_OK;
+
+  if (version > migrations_count) {
+    fprintf(stderr,
+            "Database schema version %d is newer than supported (%d).\n",
+            version, migrations_count);
+    return DB_ERR;
+  }
+
+  return DB_NOT_FOUND;
+}
+
+/*
+ * Brings the schema up to date. When user_version already matches, the only
+ * work done is reading that pragma.
+ * */
+QueryStatus db_migrate(sqlite3* db) {
+  QueryStatus status = db_check_schema(db);
+
+  if (status != DB_NOT_FOUND) return status;
+
+  return apply_migrations(db);
+}
+
+/*
+ * Drops the task_search triggers so bulk inserts skip the per-row index
+ * update. Must run inside a transaction that ends with db_restore_search, or
+ * is rolled back, so the triggers are never missing outside it.
+ * */
+QueryStatus db_drop_search_triggers(sqlite3* db) {
+  return exec(db,
+              "DROP TRIGGER IF EXISTS task_search_insert;"
+              "DROP TRIGGER IF EXISTS task_search_delete;"
+              "DROP TRIGGER IF EXISTS task_search_update");
+}
+
+/*
+ * Recreates the triggers dropped by db_drop_search_triggers and rebuilds
+ * task_search from task in one pass.
+ * */
+QueryStatus db_restore_search(sqlite3* db) {
+  return exec(db, SEARCH_TRIGGERS_SQL SEARCH_REBUILD_SQL);
+}
@@ -0,0 +1,12 @@
+#ifndef MIGRATION_H
+#define MIGRATION_H
+
+#include "database.h"
+#include "sqlite3.h"
+
+QueryStatus db_check_schema(sqlite3* db);
+QueryStatus db_migrate(sqlite3* db);
+QueryStatus db_drop_search_triggers(sqlite3* db);
+QueryStatus db_restore_search(sqlite3* db);
+
+#endif
@@ -0,0 +1,95 @@
+#include "output.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define INT_DIGITS 11
+
+/*
+ * Prepares a buffered writer for the file descriptor. Anything still pending
+ * in stdout is flushed first so both streams stay in order.
+ * */
+void output_init(Output* out, int fd) {
+  fflush(stdout);
+
+  out->fd = fd;
+  out->failed = false;
+  out->size = 0;
+}
+
+static void write_all(Output* out, const char* data, size_t size) {
+  while (size > 0 && !out->failed) {
+    ssize_t written = write(out->fd, data, size);
+
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      out->failed = true;
+      return;
+    }
+
+    data += written;
+    size -= written;
+  }
+}
+
+void output_write(Output* out, const char* data, size_t size) {
+  if (out->size + size > OUTPUT_BUFFER_SIZE) {
+    output_flush(out);
+
+    if (size > OUTPUT_BUFFER_SIZE) {
+      write_all(out, data, size);
+      return;
+    }
+  }
+
+  memcpy(out->buffer + out->size, data, size);
+  out->size += size;
+}
+
+void output_str(Output* out, const char* text) {
+  output_write(out, text, strlen(text));
+}
+
+void output_char(Output* out, char c) {
+  if (out->size == OUTPUT_BUFFER_SIZE) output_flush(out);
+
+  out->buffer[out->size++] = c;
+}
+
+/*
+ * Writes value in decimal, right-aligned with spaces to at least width
+ * characters, without going through printf.
+ * */
+void output_int(Output* out, int value, int width) {
+  char digits[INT_DIGITS];
+  char* start = digits + INT_DIGITS;
+  unsigned int magnitude = value;
+
+  if (value < 0) magnitude = -magnitude;
+
+  do {
+    *--start = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+
+  if (value < 0) *--start = '-';
+
+  size_t size = digits + INT_DIGITS - start;
+
+  for (size_t i = size; i < (size_t)width; ++i) output_char(out, ' ');
+
+  output_write(out, start, size);
+}
+
+/*
+ * Writes the buffered bytes with a single write(2) call per chunk.
+ * Returns -1 once any write to the descriptor has failed.
+ * */
+int output_flush(Output* out) {
+  write_all(out, out->buffer, out->size);
+  out->size = 0;
+
+  return out->failed ? -1 : 0;
+}
@@ -0,0 +1,23 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+  int fd;
+  bool failed;
+  size_t size;
+  char buffer[OUTPUT_BUFFER_SIZE];
+} Output;
+
+void output_init(Output* out, int fd);
+void output_write(Output* out, const char* data, size_t size);
+void output_str(Output* out, const char* text);
+void output_char(Output* out, char c);
+void output_int(Output* out, int value, int width);
+int output_flush(Output* out);
+
+#endif
@@ -0,0 +1,302 @@
+#include "profiler.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROFILE_INIT_CAP 16
+#define PROFILE_MAX_RUNS 16
+
+/*
+ * Totals for one SQL text. Cached statements are run many times, and
+ * different connections prepare the same text, so entries are keyed by the
+ * text rather than by statement.
+ * */
+typedef struct {
+  char* sql;
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+  uint64_t rows;
+  uint64_t vm_steps;
+  uint64_t sorts;
+  uint64_t autoindexes;
+  uint64_t fullscan_steps;
+  /* Some runs were timed by SQLite rather than by the profiler. */
+  bool coarse;
+} ProfileEntry;
+
+ProfileFormat profile_format = PROFILE_OFF;
+
+static ProfileEntry* entries = NULL;
+static size_t entries_size = 0;
+static size_t entries_capacity = 0;
+
+/*
+ * Statements between their TRACE_STMT and TRACE_PROFILE events. Internal
+ * statements (FTS5 shadow tables, schema reads) run nested inside the outer
+ * one, so several can be open at once.
+ * */
+typedef struct {
+  sqlite3_stmt* stmt;
+  uint64_t start_ns;
+} ActiveRun;
+
+static ActiveRun runs[PROFILE_MAX_RUNS];
+static int runs_count = 0;
+
+/* The statement whose run started last, so ROW events skip the lookup. */
+static sqlite3_stmt* current_stmt = NULL;
+static ProfileEntry* current_entry = NULL;
+
+static ProfileEntry* find_entry(const char* sql) {
+  for (size_t i = 0; i < entries_size; ++i) {
+    if (strcmp(entries[i].sql, sql) == 0) return &entries[i];
+  }
+
+  if (entries_size == entries_capacity) {
+    size_t capacity =
+        entries_capacity ? entries_capacity * 2 : PROFILE_INIT_CAP;
+    ProfileEntry* grown = realloc(entries, capacity * sizeof(ProfileEntry));
+
+    if (!grown) {
+      fprintf(stderr, "Failed to grow the SQL profile.\n");
+      exit(1);
+    }
+
+    entries = grown;
+    entries_capacity = capacity;
+  }
+
+  ProfileEntry* entry = &entries[entries_size++];
+  memset(entry, 0, sizeof(ProfileEntry));
+  entry->sql = strdup(sql);
+
+  if (!entry->sql) {
+    fprintf(stderr, "Failed to grow the SQL profile.\n");
+    exit(1);
+  }
+
+  return entry;
+}
+
+static ProfileEntry* entry_for(sqlite3_stmt* stmt) {
+  if (stmt == current_stmt && current_entry) return current_entry;
+
+  current_stmt = stmt;
+  current_entry = find_entry(sqlite3_sql(stmt));
+
+  return current_entry;
+}
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void start_run(sqlite3_stmt* stmt) {
+  if (runs_count == PROFILE_MAX_RUNS) return;
+
+  runs[runs_count].stmt = stmt;
+  runs[runs_count].start_ns = now_ns();
+  ++runs_count;
+}
+
+/*
+ * Stores the elapsed time of the statement's open run. Returns false when
+ * there is none: statements SQLite runs internally get no TRACE_STMT event,
+ * so only SQLite's own time, which many builds measure in whole
+ * milliseconds, is available for them.
+ * */
+static bool finish_run(sqlite3_stmt* stmt, uint64_t* elapsed) {
+  for (int i = runs_count - 1; i >= 0; --i) {
+    if (runs[i].stmt != stmt) continue;
+
+    *elapsed = now_ns() - runs[i].start_ns;
+
+    memmove(&runs[i], &runs[i + 1], (runs_count - i - 1) * sizeof(ActiveRun));
+    --runs_count;
+
+    return true;
+  }
+
+  return false;
+}
+
+static uint64_t take_status(sqlite3_stmt* stmt, int op) {
+  return sqlite3_stmt_status(stmt, op, 1);
+}
+
+/*
+ * TRACE_STMT marks the start of a run and re-resolves the entry, since a
+ * finalized statement's address may be reused by a different one. ROW
+ * counts rows, and PROFILE closes the run with its time and the VM
+ * counters, which are reset so each run is counted once. The time runs
+ * from the first step to the reset, like SQLite's own measurement.
+ * */
+static int trace(unsigned int event, void* context, void* p, void* x) {
+  sqlite3_stmt* stmt = p;
+  (void)context;
+
+  /* Statements without SQL text cannot be told apart; leave them out. */
+  if (!sqlite3_sql(stmt)) return 0;
+
+  if (event == SQLITE_TRACE_STMT) {
+    /* Trigger bodies are reported as comments inside the outer run. */
+    if (((const char*)x)[0] == '-' && ((const char*)x)[1] == '-') return 0;
+
+    current_stmt = NULL;
+    entry_for(stmt);
+    start_run(stmt);
+    return 0;
+  }
+
+  ProfileEntry* entry = entry_for(stmt);
+
+  if (event == SQLITE_TRACE_ROW) {
+    ++entry->rows;
+    return 0;
+  }
+
+  uint64_t ns;
+
+  if (!finish_run(stmt, &ns)) {
+    ns = *(sqlite3_int64*)x;
+    entry->coarse = true;
+  }
+
+  ++entry->count;
+  entry->total_ns += ns;
+  if (ns > entry->max_ns) entry->max_ns = ns;
+
+  entry->vm_steps += take_status(stmt, SQLITE_STMTSTATUS_VM_STEP);
+  entry->sorts += take_status(stmt, SQLITE_STMTSTATUS_SORT);
+  entry->autoindexes += take_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX);
+  entry->fullscan_steps += take_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP);
+
+  return 0;
+}
+
+void profiler_start(ProfileFormat format) { profile_format = format; }
+
+/*
+ * Starts tracing a freshly opened connection when profiling is on.
+ * */
+void profiler_attach(sqlite3* db) {
+  if (profile_format == PROFILE_OFF) return;
+
+  sqlite3_trace_v2(db,
+                   SQLITE_TRACE_STMT | SQLITE_TRACE_ROW | SQLITE_TRACE_PROFILE,
+                   trace, NULL);
+}
+
+static int compare_entries(const void* a, const void* b) {
+  const ProfileEntry* left = a;
+  const ProfileEntry* right = b;
+
+  if (left->coarse != right->coarse) return left->coarse - right->coarse;
+
+  return (left->total_ns < right->total_ns) -
+         (left->total_ns > right->total_ns);
+}
+
+static void print_json_string(const char* text) {
+  fputc('"', stderr);
+
+  for (; *text; ++text) {
+    unsigned char c = *text;
+
+    if (c == '"' || c == '\\')
+      fprintf(stderr, "\\%c", c);
+    else if (c < 0x20)
+      fprintf(stderr, "\\u%04x", c);
+    else
+      fputc(c, stderr);
+  }
+
+  fputc('"', stderr);
+}
+
+/*
+ * Coarse-timed entries are marked with '~' before their SQL.
+ * */
+static void print_table() {
+  bool coarse = false;
+
+  fprintf(stderr, "%8s %10s %10s %8s %10s %6s %8s %9s  %s\n", "count",
+          "total ms", "max ms", "rows", "vm steps", "sorts", "autoidx",
+          "fullscan", "sql");
+
+  for (size_t i = 0; i < entries_size; ++i) {
+    ProfileEntry* entry = &entries[i];
+
+    fprintf(stderr,
+            "%8llu %10.3f %10.3f %8llu %10llu %6llu %8llu %9llu  %s%s\n",
+            (unsigned long long)entry->count, entry->total_ns / 1e6,
+            entry->max_ns / 1e6, (unsigned long long)entry->rows,
+            (unsigned long long)entry->vm_steps,
+            (unsigned long long)entry->sorts,
+            (unsigned long long)entry->autoindexes,
+            (unsigned long long)entry->fullscan_steps,
+            entry->coarse ? "~ " : "", entry->sql);
+
+    coarse = coarse || entry->coarse;
+  }
+
+  if (coarse)
+    fprintf(stderr, "~ timed by SQLite, in whole milliseconds on most "
+                    "builds.\n");
+}
+
+static void print_json() {
+  fprintf(stderr, "{\"statements\": [");
+
+  for (size_t i = 0; i < entries_size; ++i) {
+    ProfileEntry* entry = &entries[i];
+
+    fprintf(stderr,
+            "%s\n  {\"count\": %llu, \"total_ns\": %llu, \"max_ns\": %llu, "
+            "\"rows\": %llu, \"vm_steps\": %llu, \"sorts\": %llu, "
+            "\"autoindexes\": %llu, \"fullscan_steps\": %llu, "
+            "\"coarse_timing\": %s, \"sql\": ",
+            i ? "," : "", (unsigned long long)entry->count,
+            (unsigned long long)entry->total_ns,
+            (unsigned long long)entry->max_ns, (unsigned long long)entry->rows,
+            (unsigned long long)entry->vm_steps,
+            (unsigned long long)entry->sorts,
+            (unsigned long long)entry->autoindexes,
+            (unsigned long long)entry->fullscan_steps,
+            entry->coarse ? "true" : "false");
+    print_json_string(entry->sql);
+    fputc('}', stderr);
+  }
+
+  fprintf(stderr, "\n]}\n");
+}
+
+/*
+ * Prints the statements by total time, slowest first, on stderr and starts
+ * a new profile. Coarse-timed entries are not comparable with the rest and
+ * come last.
+ * */
+void profiler_report() {
+  if (profile_format == PROFILE_OFF || entries_size == 0) return;
+
+  qsort(entries, entries_size, sizeof(ProfileEntry), compare_entries);
+
+  if (profile_format == PROFILE_JSON)
+    print_json();
+  else
+    print_table();
+
+  for (size_t i = 0; i < entries_size; ++i) free(entries[i].sql);
+
+  entries_size = 0;
+  runs_count = 0;
+  current_stmt = NULL;
+  current_entry = NULL;
+}
@@ -0,0 +1,16 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+#include "sqlite3.h"
+
+typedef enum { PROFILE_OFF, PROFILE_TABLE, PROFILE_JSON } ProfileFormat;
+
+extern ProfileFormat profile_format;
+
+void profiler_start(ProfileFormat format);
+void profiler_attach(sqlite3* db);
+void profiler_report();
+
+#endif
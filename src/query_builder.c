@@ -4,31 +4,53 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define SQL_INIT_SIZE 255
-#define AND_SIZE 5
-#define OR_SIZE 4
+#define SQL_INIT_SIZE 256
 
-static int qb_grow_sql(QueryBuilder* qb) {
+/*
+ * Makes room for extra more bytes plus the terminator, doubling the buffer
+ * so appends stay amortized O(1).
+ * */
+static int qb_grow_sql(QueryBuilder* qb, size_t extra) {
   if (!qb->sql) {
     fprintf(stderr, "The query builder SQL has not been initialized.\n");
     return QB_ERR_MEM;
   }
 
-  char* buf = strdup(qb->sql);
+  size_t new_size = qb->max_size;
 
-  size_t new_size = qb->max_size * 2;
-  qb->sql = realloc(qb->sql, new_size);
-  strcpy(qb->sql, buf);
+  while (new_size - qb->size <= extra) {
+    if (new_size > (size_t)-1 / 2) {
+      fprintf(stderr, "The query builder SQL is too long.\n");
+      return QB_ERR_SQLLEN;
+    }
 
-  free(buf);
+    new_size *= 2;
+  }
+
+  if (new_size == qb->max_size) return QB_OK;
+
+  char* sql = realloc(qb->sql, new_size);
+
+  if (!sql) {
+    fprintf(stderr, "Failed to grow SQL string.\n");
+    return QB_ERR_MEM;
+  }
+
+  qb->sql = sql;
+  qb->max_size = new_size;
 
   return QB_OK;
 }
 
-static char* qb_at_sql_end(QueryBuilder* qb) { return qb->sql + qb->size; }
+static int qb_append(QueryBuilder* qb, const char* text, size_t length) {
+  int rc = qb_grow_sql(qb, length);
+  if (rc != QB_OK) return rc;
+
+  memcpy(qb->sql + qb->size, text, length);
+  qb->size += length;
+  qb->sql[qb->size] = '\0';
 
-static size_t qb_remaining_sql(QueryBuilder* qb) {
-  return qb->max_size - qb->size;
+  return QB_OK;
 }
 
 int qb_init(QueryBuilder* qb) {
@@ -39,63 +61,99 @@ int qb_init(QueryBuilder* qb) {
     return QB_ERR_MEM;
   }
 
+  sql[0] = '\0';
+
   qb->sql = sql;
   qb->size = 0;
   qb->max_size = SQL_INIT_SIZE;
+  qb->has_where = false;
+  qb->terminated = false;
+  qb->param_count = 0;
 
   return QB_OK;
 }
 
 void qb_destroy(QueryBuilder* qb) { free(qb->sql); }
 
+/*
+ * Appends raw SQL. Nothing may follow a clause that ends the statement.
+ * */
 int qb_clause(QueryBuilder* qb, const char* clause) {
-  if (strstr(qb->sql, ";")) {
+  if (qb->terminated) {
     fprintf(stderr, "Cannot add clause to SQL with ';'.\n");
     return QB_ERR_SYNTAX;
   }
 
-  if (strlen(clause) > qb_remaining_sql(qb)) {
-    int rc = qb_grow_sql(qb);
-    if (rc != QB_OK) return rc;
-  }
+  size_t length = strlen(clause);
+  int rc = qb_append(qb, clause, length);
+  if (rc != QB_OK) return rc;
 
-  qb->size += snprintf(qb_at_sql_end(qb), qb_remaining_sql(qb), "%s", clause);
+  if (memchr(clause, ';', length)) qb->terminated = true;
 
   return QB_OK;
 }
 
 int qb_and(QueryBuilder* qb) {
-  if (!strstr(qb->sql, "WHERE")) {
+  if (!qb->has_where) {
     fprintf(stderr, "Cannot append AND to statements missing WHERE.\n");
     return QB_ERR_SYNTAX;
   }
 
-  size_t new_size = qb->size + AND_SIZE;
-
-  if (new_size > qb_remaining_sql(qb)) {
-    int rc = qb_grow_sql(qb);
-    if (rc != QB_OK) return rc;
-  }
-
-  qb->size += snprintf(qb_at_sql_end(qb), qb_remaining_sql(qb), "%s", " AND ");
-
-  return QB_OK;
+  return qb_clause(qb, " AND ");
 }
 
 int qb_or(QueryBuilder* qb) {
-  if (!strstr(qb->sql, "WHERE")) {
+  if (!qb->has_where) {
     fprintf(stderr, "Cannot append OR to statements missing WHERE.\n");
     return QB_ERR_SYNTAX;
   }
 
-  size_t new_size = qb->size + OR_SIZE;
+  return qb_clause(qb, " OR ");
+}
+
+/*
+ * Appends a condition, opening the WHERE clause on the first call and
+ * joining later conditions with AND.
+ * */
+int qb_where(QueryBuilder* qb, const char* condition) {
+  int rc = qb->has_where ? qb_and(qb) : qb_clause(qb, " WHERE ");
+  if (rc != QB_OK) return rc;
 
-  if (new_size > qb_remaining_sql(qb)) {
-    int rc = qb_grow_sql(qb);
-    if (rc != QB_OK) return rc;
+  rc = qb_clause(qb, condition);
+  if (rc != QB_OK) return rc;
+
+  qb->has_where = true;
+
+  return QB_OK;
+}
+
+/*
+ * Records the value for the next '?' placeholder.
+ * */
+int qb_bind_int(QueryBuilder* qb, long long value) {
+  if (qb->param_count == QB_MAX_PARAMS) {
+    fprintf(stderr, "Too many query parameters.\n");
+    return QB_ERR_PARAMS;
   }
 
-  qb->size += snprintf(qb_at_sql_end(qb), qb_remaining_sql(qb), "%s", " OR ");
+  qb->params[qb->param_count++] = value;
 
   return QB_OK;
 }
+
+/*
+ * Appends a clause holding one placeholder together with its value.
+ * */
+int qb_clause_int(QueryBuilder* qb, const char* clause, long long value) {
+  int rc = qb_clause(qb, clause);
+  if (rc != QB_OK) return rc;
+
+  return qb_bind_int(qb, value);
+}
+
+int qb_where_int(QueryBuilder* qb, const char* condition, long long value) {
+  int rc = qb_where(qb, condition);
+  if (rc != QB_OK) return rc;
+
+  return qb_bind_int(qb, value);
+}
@@ -1,12 +1,20 @@
 #ifndef QUERY_BUILDER_H
 #define QUERY_BUILDER_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
+#define QB_MAX_PARAMS 16
+
 typedef struct {
   char* sql;
   size_t size;
   size_t max_size;
+  bool has_where;
+  bool terminated;
+  /* Values for the '?' placeholders, in the order they appear in sql. */
+  long long params[QB_MAX_PARAMS];
+  size_t param_count;
 } QueryBuilder;
 
 typedef enum {
@@ -14,6 +22,7 @@ typedef enum {
   QB_ERR_MEM,
   QB_ERR_SYNTAX,
   QB_ERR_SQLLEN,
+  QB_ERR_PARAMS,
   QB_ERR_UNK
 } QueryBuilderStatus;
 
@@ -22,5 +31,9 @@ void qb_destroy(QueryBuilder* qb);
 int qb_clause(QueryBuilder* qb, const char* clause);
 int qb_and(QueryBuilder* qb);
 int qb_or(QueryBuilder* qb);
+int qb_where(QueryBuilder* qb, const char* condition);
+int qb_bind_int(QueryBuilder* qb, long long value);
+int qb_clause_int(QueryBuilder* qb, const char* clause, long long value);
+int qb_where_int(QueryBuilder* qb, const char* condition, long long value);
 
 #endif
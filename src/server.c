@@ -0,0 +1,374 @@
+#include "server.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "command.h"
+#include "database.h"
+
+#define SOCKET_PATH "foo.sock"
+#define MAX_REQUEST_SIZE (1 << 20)
+#define MAX_REQUEST_ARGS 4096
+#define CLIENT_TIMEOUT_SECONDS 5
+
+/*
+ * Wire format. The client sends a RequestHeader carrying its stdin, stdout
+ * and stderr descriptors as SCM_RIGHTS ancillary data, followed by the
+ * arguments as NUL-terminated strings. The server runs the command with
+ * those descriptors installed as its own 0, 1 and 2, then answers with the
+ * int32_t exit status.
+ * */
+typedef struct {
+  uint32_t argc;
+  uint32_t size;
+} RequestHeader;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int signal) {
+  (void)signal;
+  stopping = 1;
+}
+
+static int connect_socket() {
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", SOCKET_PATH);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+
+  if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+static bool read_all(int fd, void* data, size_t size) {
+  char* bytes = data;
+
+  while (size > 0) {
+    ssize_t got = read(fd, bytes, size);
+
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return false;
+
+    bytes += got;
+    size -= got;
+  }
+
+  return true;
+}
+
+static bool write_all(int fd, const void* data, size_t size) {
+  const char* bytes = data;
+
+  while (size > 0) {
+    ssize_t sent = write(fd, bytes, size);
+
+    if (sent < 0 && errno == EINTR) continue;
+    if (sent <= 0) return false;
+
+    bytes += sent;
+    size -= sent;
+  }
+
+  return true;
+}
+
+/*
+ * Sends the request header together with the client's standard streams.
+ * */
+static bool send_header(int fd, const RequestHeader* header) {
+  int streams[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+  char control[CMSG_SPACE(sizeof(streams))];
+  struct iovec data = {.iov_base = (void*)header, .iov_len = sizeof(*header)};
+  struct msghdr message = {.msg_iov = &data,
+                           .msg_iovlen = 1,
+                           .msg_control = control,
+                           .msg_controllen = sizeof(control)};
+
+  memset(control, 0, sizeof(control));
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(streams));
+  memcpy(CMSG_DATA(cmsg), streams, sizeof(streams));
+
+  return sendmsg(fd, &message, 0) == sizeof(*header);
+}
+
+/*
+ * Receives the request header and the three stream descriptors.
+ * */
+static bool receive_header(int fd, RequestHeader* header, int streams[3]) {
+  char control[CMSG_SPACE(3 * sizeof(int))];
+  struct iovec data = {.iov_base = header, .iov_len = sizeof(*header)};
+  struct msghdr message = {.msg_iov = &data,
+                           .msg_iovlen = 1,
+                           .msg_control = control,
+                           .msg_controllen = sizeof(control)};
+
+  if (recvmsg(fd, &message, 0) != sizeof(*header)) return false;
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+
+  if (!cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+    return false;
+
+  memcpy(streams, CMSG_DATA(cmsg), 3 * sizeof(int));
+  return true;
+}
+
+static bool is_command(const char* name, const Command* command) {
+  return strcmp(name, command->name) == 0 || strcmp(name, command->alias) == 0;
+}
+
+/*
+ * Whether the command reads the client's stdin: add --stdin, and batch
+ * without a file or with '-'. Also stores the index of batch's file
+ * argument, or 0 when there is none.
+ * */
+static bool reads_stdin(int argc, const char** argv, int* path_index) {
+  *path_index = 0;
+
+  if (argc < 2) return false;
+
+  if (is_command(argv[1], &add_command)) {
+    for (int i = 2; i < argc; ++i) {
+      if (strcmp(argv[i], "--stdin") == 0) return true;
+    }
+
+    return false;
+  }
+
+  if (!is_command(argv[1], &batch_command)) return false;
+
+  for (int i = 2; i < argc; ++i) {
+    if (strncmp(argv[i], "--help", 6) == 0) return false;
+
+    if (strcmp(argv[i], "--commit-every") == 0) {
+      ++i;
+      continue;
+    }
+
+    if (!*path_index) *path_index = i;
+  }
+
+  return !*path_index || strcmp(argv[*path_index], "-") == 0;
+}
+
+/*
+ * Hands the command to a running `foo serve` when one listens on foo.sock.
+ * Returns false, leaving the caller to run the command itself, when there is
+ * no daemon, the command is `serve` itself or it reads stdin. The server
+ * handles one request at a time, so a command waiting for EOF on an
+ * interactive stdin would block every other client.
+ * A relative batch file is sent as an absolute path, since the server
+ * resolves paths against its own working directory.
+ * */
+bool server_forward(int argc, const char** argv, int* status) {
+  if (argc > 1 && strcmp(argv[1], serve_command.name) == 0) return false;
+
+  int path_index;
+  char path[PATH_MAX];
+
+  if (reads_stdin(argc, argv, &path_index)) return false;
+
+  /* A missing file is reported by the local run. */
+  if (path_index && argv[path_index][0] != '/' &&
+      !realpath(argv[path_index], path))
+    return false;
+
+  bool resolved = path_index && argv[path_index][0] != '/';
+
+  int fd = connect_socket();
+  if (fd < 0) return false;
+
+  RequestHeader header = {.argc = argc, .size = 0};
+
+  for (int i = 0; i < argc; ++i) {
+    const char* arg = resolved && i == path_index ? path : argv[i];
+    header.size += strlen(arg) + 1;
+  }
+
+  bool sent = send_header(fd, &header);
+
+  for (int i = 0; sent && i < argc; ++i) {
+    const char* arg = resolved && i == path_index ? path : argv[i];
+    sent = write_all(fd, arg, strlen(arg) + 1);
+  }
+
+  int32_t rc;
+
+  if (!sent || !read_all(fd, &rc, sizeof(rc))) {
+    fprintf(stderr, "Lost connection to the foo server.\n");
+    rc = COMM_ERR_DATABASE;
+  }
+
+  close(fd);
+
+  *status = rc;
+  return true;
+}
+
+/*
+ * Runs one forwarded command with the client's streams installed as the
+ * process's standard streams, restoring the server's own afterwards.
+ * */
+static int run_request(int client, const int saved[3]) {
+  RequestHeader header;
+  int streams[3];
+
+  if (!receive_header(client, &header, streams)) return -1;
+
+  int32_t rc = COMM_ERR_INVALID_ARGS;
+  char* payload = NULL;
+  const char** argv = NULL;
+
+  if (header.argc == 0 || header.argc > MAX_REQUEST_ARGS ||
+      header.size > MAX_REQUEST_SIZE)
+    goto cleanup;
+
+  payload = malloc(header.size);
+  argv = malloc((header.argc + 1) * sizeof(char*));
+
+  if (!payload || !argv || !read_all(client, payload, header.size) ||
+      payload[header.size - 1] != '\0')
+    goto cleanup;
+
+  char* arg = payload;
+
+  for (uint32_t i = 0; i < header.argc; ++i) {
+    if (arg >= payload + header.size) goto cleanup;
+
+    argv[i] = arg;
+    arg += strlen(arg) + 1;
+  }
+
+  argv[header.argc] = NULL;
+
+  fflush(stdout);
+  fflush(stderr);
+
+  for (int i = 0; i < 3; ++i) dup2(streams[i], i);
+
+  rc = run_command(header.argc, argv);
+
+  if (db_rollback() != DB_OK) rc = COMM_ERR_DATABASE;
+
+  fflush(stdout);
+  fflush(stderr);
+
+  /* glibc drops buffered input on fflush(stdin); the next client must not
+   * see bytes read ahead from this one. */
+  fflush(stdin);
+  clearerr(stdin);
+
+  for (int i = 0; i < 3; ++i) dup2(saved[i], i);
+
+cleanup:
+  for (int i = 0; i < 3; ++i) close(streams[i]);
+  free(payload);
+  free(argv);
+
+  write_all(client, &rc, sizeof(rc));
+  return 0;
+}
+
+static int listen_socket() {
+  int running = connect_socket();
+
+  if (running >= 0) {
+    close(running);
+    fprintf(stderr, "A foo server is already listening on %s.\n",
+            SOCKET_PATH);
+    return -1;
+  }
+
+  unlink(SOCKET_PATH);
+
+  struct sockaddr_un address = {.sun_family = AF_UNIX};
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", SOCKET_PATH);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      chmod(SOCKET_PATH, S_IRUSR | S_IWUSR) != 0 || listen(fd, 64) != 0) {
+    fprintf(stderr, "Failed to listen on %s: %s.\n", SOCKET_PATH,
+            strerror(errno));
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+/*
+ * Keeps one warm connection, with its cached statements, and serves the
+ * commands forwarded by other foo processes one at a time until SIGINT or
+ * SIGTERM.
+ * */
+int serve(int argc, const char** argv) {
+  if (argc > 2) {
+    if (strncmp(argv[2], "--help", 6) == 0) {
+      printf("%s", serve_command.help);
+      return COMM_OK;
+    }
+
+    fprintf(stderr, "Unknown argument '%s'.\n", argv[2]);
+    return COMM_ERR_INVALID_ARGS;
+  }
+
+  if (db_init() != DB_OK) return COMM_ERR_DATABASE;
+
+  int server = listen_socket();
+  if (server < 0) return COMM_ERR_INVALID_ARGS;
+
+  struct sigaction action = {.sa_handler = stop};
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  int saved[3];
+  for (int i = 0; i < 3; ++i) saved[i] = dup(i);
+
+  while (!stopping) {
+    int client = accept(server, NULL, NULL);
+
+    if (client < 0) {
+      if (errno == EINTR) continue;
+      fprintf(stderr, "Failed to accept client: %s.\n", strerror(errno));
+      break;
+    }
+
+    /* Requests are served one at a time, so a client that stalls while
+     * sending one must not hold up the rest for longer than this. */
+    struct timeval timeout = {.tv_sec = CLIENT_TIMEOUT_SECONDS};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    run_request(client, saved);
+    close(client);
+  }
+
+  for (int i = 0; i < 3; ++i) close(saved[i]);
+
+  close(server);
+  unlink(SOCKET_PATH);
+
+  return COMM_OK;
+}
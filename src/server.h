@@ -0,0 +1,9 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+
+int serve(int argc, const char** argv);
+bool server_forward(int argc, const char** argv, int* status);
+
+#endif
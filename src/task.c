@@ -5,79 +5,195 @@
 #include <string.h>
 
 /*
- * Creates a Task object from all of its properties.
- * The title is copied into the object.
+ * Copies title into the arena, doubling its capacity as needed so appends
+ * stay amortized O(1), and returns the copy's offset.
  * */
-Task* new_task(int id, const char* title, bool finished) {
-  Task* task = malloc(sizeof(Task));
+static size_t append_title(TitleArena* arena, const char* title) {
+  size_t title_size = strlen(title) + 1;
+  size_t new_capacity = arena->capacity ? arena->capacity : TITLES_INIT_CAP;
 
-  if (!task) {
-    fprintf(stderr, "Failed to create task.\n");
+  while (new_capacity - arena->size < title_size) new_capacity *= 2;
+
+  if (new_capacity != arena->capacity) {
+    char* data = realloc(arena->data, new_capacity);
+
+    if (!data) {
+      fprintf(stderr, "Failed to grow task titles.\n");
+      exit(1);
+    }
+
+    arena->data = data;
+    arena->capacity = new_capacity;
+  }
+
+  size_t offset = arena->size;
+
+  memcpy(arena->data + offset, title, title_size);
+  arena->size += title_size;
+
+  return offset;
+}
+
+#define BITMAP_WORDS(bits) (((bits) + 63) / 64)
+
+static void resize_columns(TaskColumns* columns, size_t capacity) {
+  int* ids = realloc(columns->ids, capacity * sizeof(int));
+  size_t* title_offsets =
+      realloc(columns->title_offsets, capacity * sizeof(size_t));
+  uint64_t* finished =
+      realloc(columns->finished, BITMAP_WORDS(capacity) * sizeof(uint64_t));
+
+  if (ids) columns->ids = ids;
+  if (title_offsets) columns->title_offsets = title_offsets;
+  if (finished) columns->finished = finished;
+
+  if (!ids || !title_offsets || !finished) {
+    fprintf(stderr, "Failed to grow task columns.\n");
     exit(1);
   }
 
-  task->id = id;
-  strcpy(task->title, title);
-  task->finished = finished;
+  size_t old_words = BITMAP_WORDS(columns->capacity);
+  size_t new_words = BITMAP_WORDS(capacity);
+
+  if (new_words > old_words)
+    memset(finished + old_words, 0, (new_words - old_words) * sizeof(uint64_t));
 
-  return task;
+  columns->capacity = capacity;
 }
 
-Task* create_task(const char* title) {
-  Task* task = malloc(sizeof(Task));
+TaskColumns* create_columns(size_t capacity) {
+  TaskColumns* columns = calloc(1, sizeof(TaskColumns));
 
-  if (!task) {
-    fprintf(stderr, "Failed to create task.\n");
+  if (!columns) {
+    fprintf(stderr, "Failed to create task columns.\n");
     exit(1);
   }
 
-  strcpy(task->title, title);
-  task->finished = false;
+  if (capacity == 0) capacity = TASKS_INIT_CAP;
 
-  return task;
+  resize_columns(columns, capacity);
+
+  return columns;
 }
 
-void destroy_task(Task* task) { free(task); }
+void add_to_columns(TaskColumns* columns, int id, const char* title,
+                    bool finished) {
+  if (columns->size == columns->capacity)
+    resize_columns(columns, columns->capacity * 2);
 
-static void grow_list(List* list) {
-  size_t new_capacity = list->capacity * 2;
+  size_t row = columns->size++;
 
-  list->items = realloc(list->items, list->capacity * sizeof(Task));
+  columns->ids[row] = id;
+  columns->title_offsets[row] = append_title(&columns->titles, title);
 
-  if (!list->items) {
-    fprintf(stderr, "Failed to grow list.\n");
-    exit(1);
-  }
+  if (finished) columns->finished[row / 64] |= UINT64_C(1) << (row % 64);
+}
 
-  list->capacity = new_capacity;
+void reserve_columns(TaskColumns* columns, size_t capacity) {
+  if (capacity > columns->capacity) resize_columns(columns, capacity);
 }
 
-List* create_list() {
-  List* list = malloc(sizeof(List));
+bool column_finished(const TaskColumns* columns, size_t row) {
+  return columns->finished[row / 64] >> (row % 64) & 1;
+}
 
-  if (!list) {
-    fprintf(stderr, "Failed to create list.\n");
-    exit(1);
+const char* column_title(const TaskColumns* columns, size_t row) {
+  return columns->titles.data + columns->title_offsets[row];
+}
+
+/*
+ * Counts finished rows with one popcount per 64 rows. Bits past the last row
+ * are always clear, so whole words can be counted.
+ * */
+size_t count_finished(const TaskColumns* columns) {
+  size_t count = 0;
+  size_t words = BITMAP_WORDS(columns->size);
+
+  for (size_t i = 0; i < words; ++i)
+    count += __builtin_popcountll(columns->finished[i]);
+
+  return count;
+}
+
+/*
+ * Writes the indices of the rows whose finished flag matches into rows, in
+ * row order, and returns how many were written. Only the bitmap is read.
+ * */
+size_t select_rows(const TaskColumns* columns, bool finished, size_t* rows) {
+  size_t count = 0;
+  size_t words = BITMAP_WORDS(columns->size);
+
+  for (size_t i = 0; i < words; ++i) {
+    uint64_t word = finished ? columns->finished[i] : ~columns->finished[i];
+
+    if (i == words - 1 && columns->size % 64)
+      word &= (UINT64_C(1) << (columns->size % 64)) - 1;
+
+    while (word) {
+      rows[count++] = i * 64 + __builtin_ctzll(word);
+      word &= word - 1;
+    }
   }
 
-  list->items = malloc(LIST_INIT_CAP * sizeof(Task));
-  list->size = 0;
-  list->capacity = LIST_INIT_CAP;
+  return count;
+}
+
+/*
+ * Fills rows with every row index, pending rows first and finished rows
+ * after, each group in row order. Returns the number of pending rows.
+ * */
+size_t partition_rows(const TaskColumns* columns, size_t* rows) {
+  size_t pending = select_rows(columns, false, rows);
+  select_rows(columns, true, rows + pending);
+  return pending;
+}
+
+typedef struct {
+  const char* title;
+  size_t row;
+} TitleKey;
+
+static int compare_titles(const void* a, const void* b) {
+  const TitleKey* left = a;
+  const TitleKey* right = b;
+  int order = strcmp(left->title, right->title);
+
+  if (order != 0) return order;
 
-  return list;
+  return (left->row > right->row) - (left->row < right->row);
 }
 
-void add_to_list(List* list, int id, const char* title, bool finished) {
-  if (list->size == list->capacity) grow_list(list);
+/*
+ * Orders the given row indices by title, breaking ties by row so the result
+ * is stable. Only the title column is read.
+ * */
+void sort_rows_by_title(const TaskColumns* columns, size_t* rows,
+                        size_t count) {
+  if (count < 2) return;
+
+  TitleKey* keys = malloc(count * sizeof(TitleKey));
+
+  if (!keys) {
+    fprintf(stderr, "Failed to sort task columns.\n");
+    exit(1);
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    keys[i].title = column_title(columns, rows[i]);
+    keys[i].row = rows[i];
+  }
+
+  qsort(keys, count, sizeof(TitleKey), compare_titles);
 
-  Task* task = &list->items[list->size++];
+  for (size_t i = 0; i < count; ++i) rows[i] = keys[i].row;
 
-  task->id = id;
-  strncpy(task->title, title, sizeof(task->title));
-  task->finished = finished;
+  free(keys);
 }
 
-void destroy_list(List* list) {
-  free(list->items);
-  free(list);
+void destroy_columns(TaskColumns* columns) {
+  free(columns->ids);
+  free(columns->finished);
+  free(columns->title_offsets);
+  free(columns->titles.data);
+  free(columns);
 }
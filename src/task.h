@@ -3,28 +3,47 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
-#define LIST_INIT_CAP 8
-#define TASK_TITLE_SIZE 255
+#define TASKS_INIT_CAP 8
+#define TITLES_INIT_CAP 256
 
+/*
+ * An append-only string arena. Strings are copied in with their terminating
+ * NUL and referred to by offset, which stays valid when the arena grows.
+ * */
 typedef struct {
-  int id;
-  char title[TASK_TITLE_SIZE];
-  bool finished;
-} Task;
+  char* data;
+  size_t size;
+  size_t capacity;
+} TitleArena;
 
+/*
+ * A column-oriented task list: ids, the finished flags (one bit per row) and
+ * title offsets live in separate arrays, so passes over one column never pull
+ * the others through the cache. Rows keep insertion order; operations that
+ * filter or reorder work on arrays of row indices instead of moving rows.
+ * */
 typedef struct {
-  Task* items;
+  int* ids;
+  uint64_t* finished;
+  size_t* title_offsets;
   size_t size;
   size_t capacity;
-} List;
-
-Task* new_task(int id, const char* title, bool finished);
-Task* create_task(const char* title);
-void destroy_task(Task* task);
+  TitleArena titles;
+} TaskColumns;
 
-List* create_list();
-void add_to_list(List* list, int id, const char* title, bool finished);
-void destroy_list(List* list);
+TaskColumns* create_columns(size_t capacity);
+void add_to_columns(TaskColumns* columns, int id, const char* title,
+                    bool finished);
+void reserve_columns(TaskColumns* columns, size_t capacity);
+bool column_finished(const TaskColumns* columns, size_t row);
+const char* column_title(const TaskColumns* columns, size_t row);
+size_t count_finished(const TaskColumns* columns);
+size_t select_rows(const TaskColumns* columns, bool finished, size_t* rows);
+size_t partition_rows(const TaskColumns* columns, size_t* rows);
+void sort_rows_by_title(const TaskColumns* columns, size_t* rows,
+                        size_t count);
+void destroy_columns(TaskColumns* columns);
 
 #endif
@@ -0,0 +1,136 @@
+#include "timing.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TIMING_MAX_DEPTH 16
+#define TIMING_CALIBRATION_READS 64
+
+typedef struct {
+  double wall;
+  double cpu;
+} Clock;
+
+bool timing_enabled = false;
+
+static const char* phase_names[PHASE_COUNT] = {
+    [PHASE_STARTUP] = "startup",         [PHASE_COMMAND] = "command",
+    [PHASE_OPEN] = "open",               [PHASE_PREPARE] = "prepare",
+    [PHASE_STEP] = "step",               [PHASE_MATERIALIZE] = "materialize",
+    [PHASE_RENDER] = "render",           [PHASE_CLOSE] = "close"};
+
+static Clock totals[PHASE_COUNT];
+static TimingPhase stack[TIMING_MAX_DEPTH];
+static int depth = 0;
+static Clock last;
+static Clock read_cost;
+static unsigned long long reads = 0;
+
+static double seconds(clockid_t id) {
+  struct timespec ts;
+  clock_gettime(id, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static Clock now() {
+  return (Clock){seconds(CLOCK_MONOTONIC), seconds(CLOCK_PROCESS_CPUTIME_ID)};
+}
+
+/*
+ * Charges the time since the last boundary to the phase on top of the stack.
+ * */
+static void charge() {
+  Clock current = now();
+  TimingPhase phase = stack[depth - 1];
+
+  totals[phase].wall += current.wall - last.wall;
+  totals[phase].cpu += current.cpu - last.cpu;
+  last = current;
+  ++reads;
+}
+
+/*
+ * Wall time from the kernel's process start (in clock ticks, so only
+ * 1/CLK_TCK precise) to now.
+ * */
+static double since_process_start() {
+  unsigned long long start_ticks;
+  FILE* stat = fopen("/proc/self/stat", "r");
+
+  if (!stat) return 0;
+
+  /* Field 22; the command name in field 2 may hold spaces, so skip past
+   * its closing parenthesis first. */
+  int matched = fscanf(stat,
+                       "%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+                       "%*u %*u %*d %*d %*d %*d %*d %*d %llu",
+                       &start_ticks);
+  fclose(stat);
+
+  if (matched != 1) return 0;
+
+  double elapsed = seconds(CLOCK_BOOTTIME) -
+                   (double)start_ticks / sysconf(_SC_CLK_TCK);
+
+  return elapsed > 0 ? elapsed : 0;
+}
+
+/*
+ * Enables timing from main. What ran before main (loading, libc start-up) is
+ * recorded as the startup phase, and the command phase starts now.
+ * */
+void timing_start() {
+  Clock first = now();
+
+  for (int i = 0; i < TIMING_CALIBRATION_READS; ++i) last = now();
+
+  read_cost.wall = (last.wall - first.wall) / TIMING_CALIBRATION_READS;
+  read_cost.cpu = (last.cpu - first.cpu) / TIMING_CALIBRATION_READS;
+
+  timing_enabled = true;
+  last = now();
+
+  totals[PHASE_STARTUP].wall = since_process_start();
+  totals[PHASE_STARTUP].cpu = last.cpu;
+
+  depth = 0;
+  stack[depth++] = PHASE_COMMAND;
+}
+
+void timing_push(TimingPhase phase) {
+  charge();
+
+  if (depth < TIMING_MAX_DEPTH) stack[depth++] = phase;
+}
+
+void timing_pop() {
+  charge();
+
+  if (depth > 1) --depth;
+}
+
+void timing_report() {
+  Clock total = {0};
+
+  charge();
+
+  fprintf(stderr, "%-14s%12s%12s\n", "phase", "wall ms", "cpu ms");
+
+  for (int i = 0; i < PHASE_COUNT; ++i) {
+    fprintf(stderr, "%-14s%12.3f%12.3f\n", phase_names[i],
+            totals[i].wall * 1e3, totals[i].cpu * 1e3);
+
+    total.wall += totals[i].wall;
+    total.cpu += totals[i].cpu;
+  }
+
+  fprintf(stderr, "%-14s%12.3f%12.3f\n", "total", total.wall * 1e3,
+          total.cpu * 1e3);
+
+  /* Clock reads are charged to the phases they sit between; show what they
+   * are estimated to add so per-row phases can be read with that in mind. */
+  fprintf(stderr, "%-14s%12.3f%12.3f  (%llu clock reads, included above)\n",
+          "overhead", reads * read_cost.wall * 1e3,
+          reads * read_cost.cpu * 1e3, reads);
+}
@@ -0,0 +1,44 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+
+/*
+ * Phases of one invocation. Time is charged to the innermost active phase
+ * only, so the phases add up to the whole run; anything outside the named
+ * phases (argument parsing, in-memory sorting, ...) counts as command.
+ * */
+typedef enum {
+  PHASE_STARTUP,
+  PHASE_COMMAND,
+  PHASE_OPEN,
+  PHASE_PREPARE,
+  PHASE_STEP,
+  PHASE_MATERIALIZE,
+  PHASE_RENDER,
+  PHASE_CLOSE,
+  PHASE_COUNT,
+} TimingPhase;
+
+extern bool timing_enabled;
+
+/*
+ * The checks are inlined so a disabled run pays one predictable branch per
+ * phase boundary.
+ * */
+#define TIMING_PUSH(phase)                  \
+  do {                                      \
+    if (timing_enabled) timing_push(phase); \
+  } while (0)
+
+#define TIMING_POP()                  \
+  do {                                \
+    if (timing_enabled) timing_pop(); \
+  } while (0)
+
+void timing_start();
+void timing_push(TimingPhase phase);
+void timing_pop();
+void timing_report();
+
+#endif
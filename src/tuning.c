@@ -0,0 +1,155 @@
+#include "tuning.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "config.h"
+
+/*
+ * durable keeps SQLite's defaults. balanced moves to WAL with NORMAL syncs,
+ * which only fsyncs at checkpoints, and fast also skips those syncs, so
+ * an OS crash may lose the latest commits but never corrupts the file.
+ * A NULL or zero per-connection setting leaves SQLite's default in place.
+ * */
+static const TuningProfile profiles[] = {
+    {.name = "durable", .journal_mode = "DELETE", .page_size = 4096},
+    {.name = "balanced",
+     .journal_mode = "WAL",
+     .synchronous = "NORMAL",
+     .mmap_size = 256LL * 1024 * 1024,
+     .cache_size = -16384,
+     .temp_store = "MEMORY",
+     .page_size = 4096},
+    {.name = "fast",
+     .journal_mode = "WAL",
+     .synchronous = "OFF",
+     .mmap_size = 1024LL * 1024 * 1024,
+     .cache_size = -65536,
+     .temp_store = "MEMORY",
+     .page_size = 8192},
+};
+
+static const size_t profiles_count = sizeof(profiles) / sizeof(TuningProfile);
+
+/*
+ * Returns the profile named by FOO_TUNING or the "tuning" key in foo.conf,
+ * defaulting to durable.
+ * */
+const TuningProfile* tuning_profile() {
+  static const TuningProfile* active = NULL;
+
+  if (active) return active;
+
+  const char* name = config_get("tuning");
+  active = &profiles[0];
+
+  if (!name) return active;
+
+  for (size_t i = 0; i < profiles_count; ++i) {
+    if (strcmp(profiles[i].name, name) == 0) return active = &profiles[i];
+  }
+
+  fprintf(stderr, "Unknown tuning profile '%s', using '%s'.\n", name,
+          active->name);
+  return active;
+}
+
+static QueryStatus pragma(sqlite3* db, const char* name, const char* value) {
+  char sql[96];
+  char* err = NULL;
+
+  snprintf(sql, sizeof(sql), "PRAGMA %s = %s", name, value);
+
+  if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+    fprintf(stderr, "Failed to set %s: %s.\n", name, err);
+    sqlite3_free(err);
+    return DB_ERR;
+  }
+
+  return DB_OK;
+}
+
+/*
+ * Reads a pragma's current value as text.
+ * */
+static QueryStatus read_pragma(sqlite3* db, const char* name, char* value,
+                               size_t size) {
+  char sql[64];
+  sqlite3_stmt* stmt = NULL;
+  QueryStatus status = DB_ERR;
+
+  snprintf(sql, sizeof(sql), "PRAGMA %s", name);
+
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK ||
+      sqlite3_step(stmt) != SQLITE_ROW) {
+    fprintf(stderr, "Failed to read %s: %s.\n", name, sqlite3_errmsg(db));
+    goto cleanup;
+  }
+
+  snprintf(value, size, "%s", (const char*)sqlite3_column_text(stmt, 0));
+  status = DB_OK;
+
+cleanup:
+  sqlite3_finalize(stmt);
+  return status;
+}
+
+/*
+ * Applies the active profile's per-connection settings to a freshly opened
+ * connection. Settings the profile leaves unset cost nothing, so durable
+ * opens run no pragmas at all.
+ * */
+QueryStatus tuning_apply(sqlite3* db) {
+  const TuningProfile* profile = tuning_profile();
+  char value[32];
+
+  if (profile->synchronous &&
+      pragma(db, "synchronous", profile->synchronous) != DB_OK)
+    return DB_ERR;
+
+  if (profile->mmap_size) {
+    snprintf(value, sizeof(value), "%lld", profile->mmap_size);
+    if (pragma(db, "mmap_size", value) != DB_OK) return DB_ERR;
+  }
+
+  if (profile->cache_size) {
+    snprintf(value, sizeof(value), "%d", profile->cache_size);
+    if (pragma(db, "cache_size", value) != DB_OK) return DB_ERR;
+  }
+
+  if (profile->temp_store &&
+      pragma(db, "temp_store", profile->temp_store) != DB_OK)
+    return DB_ERR;
+
+  return DB_OK;
+}
+
+/*
+ * Applies the page size and journal mode, which are stored in the file, when
+ * they differ from the profile. Meant to run only when the schema is created
+ * or migrated: changing the journal mode takes an exclusive lock and may fail
+ * with SQLITE_BUSY, and the page size only takes effect before the first
+ * table is created (or after VACUUM).
+ * */
+QueryStatus tuning_apply_storage(sqlite3* db) {
+  const TuningProfile* profile = tuning_profile();
+  char value[32];
+
+  if (read_pragma(db, "page_size", value, sizeof(value)) != DB_OK)
+    return DB_ERR;
+
+  if (atoi(value) != profile->page_size) {
+    snprintf(value, sizeof(value), "%d", profile->page_size);
+    if (pragma(db, "page_size", value) != DB_OK) return DB_ERR;
+  }
+
+  if (read_pragma(db, "journal_mode", value, sizeof(value)) != DB_OK)
+    return DB_ERR;
+
+  if (strcasecmp(value, profile->journal_mode) != 0)
+    return pragma(db, "journal_mode", profile->journal_mode);
+
+  return DB_OK;
+}
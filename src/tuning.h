@@ -0,0 +1,21 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "database.h"
+#include "sqlite3.h"
+
+typedef struct {
+  const char* name;
+  const char* journal_mode;
+  const char* synchronous;
+  long long mmap_size;
+  int cache_size;
+  const char* temp_store;
+  int page_size;
+} TuningProfile;
+
+const TuningProfile* tuning_profile();
+QueryStatus tuning_apply(sqlite3* db);
+QueryStatus tuning_apply_storage(sqlite3* db);
+
+#endif
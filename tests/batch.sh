@@ -0,0 +1,53 @@
+#!/bin/sh
+# foo batch: line commands, per-line errors and --commit-every.
+
+. "$(dirname "$0")/lib.sh"
+
+cat > commands <<'END'
+# comments and blank lines are skipped
+
+add first task
+a second task
+add third task
+check 1
+c 2
+uncheck 2
+del 3
+END
+
+run batch commands
+expect_status 0
+expect_out
+expect_err
+
+run list
+expect_out "-   1. [x] first task" "-   2. [ ] second task"
+
+printf 'add kept\nfrobnicate 1\ncheck x\ncheck 99\nadd\ncheck 4\n' > commands
+
+run batch --commit-every 2 commands
+expect_status 1
+expect_err "Unknown command 'frobnicate' on line 2." \
+  "Invalid task ID 'x' on line 3." \
+  "Task 99 not found on line 4." \
+  "Missing argument for 'add' on line 5."
+
+run list --after 2
+expect_out "-   4. [x] kept"
+
+# An already checked task is found, not reported missing.
+"$FOO" batch - > out 2> err <<'END'
+check 4
+check 4
+uncheck 4
+END
+status=$?
+expect_status 0
+expect_err
+
+run list --pending --after 3
+expect_out "-   4. [ ] kept"
+
+run batch missing-file
+expect_status 2
+expect_err "Failed to open 'missing-file'."
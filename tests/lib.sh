@@ -0,0 +1,57 @@
+# Helpers shared by the CLI tests. Each test script sources this file with
+# the path of the foo binary as its first argument and runs in a fresh
+# scratch directory, so foo.db and foo.sock never leak between tests.
+
+FOO=$1
+
+if [ ! -x "$FOO" ]; then
+  echo "Usage: $0 <path to foo>" >&2
+  exit 2
+fi
+
+SCRATCH=$(mktemp -d) || exit 1
+trap 'rm -rf "$SCRATCH"' EXIT
+cd "$SCRATCH" || exit 1
+
+unset FOO_MODE FOO_TUNING FOO_TIMING FOO_PROFILE
+
+fail() {
+  echo "FAIL: $*" >&2
+  exit 1
+}
+
+# run <args...>: runs foo, keeping its stdout, stderr and exit status.
+run() {
+  "$FOO" "$@" > out 2> err
+  status=$?
+}
+
+# expect_status <status>: checks the exit status of the last run.
+expect_status() {
+  [ "$status" -eq "$1" ] || fail "expected status $1, got $status"
+}
+
+# lines <line...>: writes one line per argument to expected, or an empty
+# file when there are none.
+lines() {
+  : > expected
+  [ $# -eq 0 ] || printf '%s\n' "$@" > expected
+}
+
+# expect_out [line...]: checks the stdout of the last run.
+expect_out() {
+  lines "$@"
+  cmp -s expected out || fail "unexpected output:
+$(cat out)
+expected:
+$(cat expected)"
+}
+
+# expect_err [line...]: same as expect_out, for stderr.
+expect_err() {
+  lines "$@"
+  cmp -s expected err || fail "unexpected errors:
+$(cat err)
+expected:
+$(cat expected)"
+}
@@ -0,0 +1,53 @@
+#!/bin/sh
+# FOO_MODE=memory: changes reach foo.db at each commit, and foo.db stays
+# locked for the whole session, so no other process's commit can be lost.
+
+. "$(dirname "$0")/lib.sh"
+
+run add "on disk"
+expect_status 0
+
+FOO_MODE=memory "$FOO" add "in memory" > out 2> err
+status=$?
+expect_status 0
+
+run list
+expect_out "-   1. [ ] on disk" "-   2. [ ] in memory"
+
+# Keep a memory-mode batch open on a FIFO while another process writes.
+mkfifo commands
+FOO_MODE=memory "$FOO" batch --commit-every 1 < commands > batch.out \
+  2> batch.err &
+batch=$!
+exec 3> commands
+
+printf 'add first\n' >&3
+sleep 1
+
+run add "from another process"
+expect_status 4
+grep -q "database is locked" err || fail "the writer was not refused: $(cat err)"
+
+printf 'add second\n' >&3
+exec 3>&-
+wait $batch
+status=$?
+expect_status 0
+
+run list
+expect_out "-   1. [ ] on disk" "-   2. [ ] in memory" "-   3. [ ] first" \
+  "-   4. [ ] second"
+
+# Memory mode does not start while another process is writing.
+"$FOO" batch < commands > batch.out 2> batch.err &
+batch=$!
+exec 3> commands
+sleep 1
+
+FOO_MODE=memory "$FOO" list > out 2> err
+status=$?
+expect_status 4
+expect_err "Failed to lock foo.db for memory mode: database is locked."
+
+exec 3>&-
+wait $batch
@@ -0,0 +1,47 @@
+#!/bin/sh
+# Schema migrations: a foo.db written before user_version was tracked is
+# upgraded in place, and one from a newer foo is refused. Needs the sqlite3
+# shell to write those files.
+
+. "$(dirname "$0")/lib.sh"
+
+if ! command -v sqlite3 > /dev/null; then
+  echo "sqlite3 shell not found, skipping."
+  exit 77
+fi
+
+# The schema foo created before migrations existed, at user_version 0.
+sqlite3 foo.db <<'END' || fail "could not create the old database"
+CREATE TABLE IF NOT EXISTS task (
+  id INTEGER PRIMARY KEY AUTOINCREMENT,
+  title VARCHAR(255) NOT NULL,
+  description VARCHAR(255),
+  finished BOOLEAN DEFAULT FALSE,
+  created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP);
+INSERT INTO task(title, finished) VALUES ('Old pending task', FALSE);
+INSERT INTO task(title, finished) VALUES ('Old finished task', TRUE);
+END
+
+run list
+expect_status 0
+expect_out "-   1. [ ] Old pending task" "-   2. [x] Old finished task"
+
+[ "$(sqlite3 foo.db 'PRAGMA user_version')" = 3 ] ||
+  fail "user_version was not brought up to date"
+
+# Rows from before the search index existed are indexed by the migration.
+run search finished
+expect_out "-   2. [x] Old *finished* task"
+
+run list --pending --explain
+expect_status 0
+grep -q task_pending out || fail "the pending index is missing"
+
+run add "New task"
+expect_out "Added task 3."
+
+sqlite3 foo.db 'PRAGMA user_version = 99'
+
+run list
+expect_status 4
+expect_err "Database schema version 99 is newer than supported (3)."
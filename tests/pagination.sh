@@ -0,0 +1,45 @@
+#!/bin/sh
+# Keyset pagination: --after, --before and --limit, alone and with filters.
+
+. "$(dirname "$0")/lib.sh"
+
+run add one two three four five six
+expect_status 0
+
+run check 2 4
+expect_status 0
+
+run list --after 2 --before 6
+expect_status 0
+expect_out "-   3. [ ] three" "-   4. [x] four" "-   5. [ ] five"
+
+run list --after 4 --limit 1
+expect_out "-   5. [ ] five"
+
+run list --after 1 --before 6 --limit 2
+expect_out "-   2. [x] two" "-   3. [ ] three"
+
+# --before with --limit takes the tasks closest to the bound, still listed
+# in ascending order.
+run list --before 5 --limit 2
+expect_out "-   3. [ ] three" "-   4. [x] four"
+
+run list --before 2 --limit 3
+expect_out "-   1. [ ] one"
+
+run list --pending --after 1 --limit 2
+expect_out "-   3. [ ] three" "-   5. [ ] five"
+
+run list --pending --before 6 --limit 2
+expect_out "-   3. [ ] three" "-   5. [ ] five"
+
+run list --done --after 2
+expect_out "-   4. [x] four"
+
+run list --before 1
+expect_status 0
+expect_out "No tasks."
+
+run list --after x
+expect_status 2
+expect_err "Invalid value for '--after'."
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Range parsing, merging and reporting for check, uncheck and del.
+
+. "$(dirname "$0")/lib.sh"
+
+run add one two three four five six
+expect_status 0
+expect_out "Added 6 tasks (1-6)."
+
+run check 2-3 1 3-4
+expect_status 0
+expect_out
+
+run list --done
+expect_out "-   1. [x] one" "-   2. [x] two" "-   3. [x] three" \
+  "-   4. [x] four"
+
+run check 4-5 8 7-9
+expect_status 3
+expect_out "Already completed: 4."
+expect_err "Not found: 7-9."
+
+run uncheck 1 2-6
+expect_status 0
+expect_out "Already pending: 6."
+
+run check 3-2
+expect_status 2
+expect_err "Invalid task ID '3-2'."
+
+run check 1-x
+expect_status 2
+expect_err "Invalid task ID '1-x'."
+
+run del 2-3 5 3-4
+expect_status 0
+
+run list
+expect_out "-   1. [ ] one" "-   6. [ ] six"
+
+run del 1-6
+expect_status 3
+expect_err "Not found: 2-5."
+
+run list
+expect_out "No tasks."
+
+run check 1-16000000 16000001-32000000
+expect_status 2
+expect_err "Task ID range 1-32000000 is too large."
@@ -0,0 +1,32 @@
+#!/bin/sh
+# foo search: the FTS5 index follows inserts and deletes, and queries support
+# prefixes, several words and diacritic-insensitive matching.
+
+. "$(dirname "$0")/lib.sh"
+
+run add "Deploy the café release" "Review deploy notes" "Write docs" \
+  "Plan deployment"
+expect_status 0
+
+run search deploy
+expect_status 0
+expect_out "-   2. [ ] Review *deploy* notes" \
+  "-   1. [ ] *Deploy* the café release"
+
+run search "dep*" --limit 2
+expect_out "-   4. [ ] Plan *deployment*" "-   2. [ ] Review *deploy* notes"
+
+run search cafe release
+expect_out "-   1. [ ] Deploy the *café* *release*"
+
+run check 2
+run search notes
+expect_out "-   2. [x] Review deploy *notes*"
+
+run del 1
+run search cafe
+expect_status 0
+expect_out "No matching tasks."
+
+run search
+expect_status 2
@@ -0,0 +1,58 @@
+#!/bin/sh
+# foo serve: commands are forwarded over foo.sock with their streams and
+# exit status, except those reading stdin, and the socket is removed on
+# shutdown.
+
+. "$(dirname "$0")/lib.sh"
+
+mkdir server client
+cd server || exit 1
+
+"$FOO" serve &
+server=$!
+trap 'kill $server 2> /dev/null; rm -rf "$SCRATCH"' EXIT
+
+for attempt in 1 2 3 4 5 6 7 8 9 10; do
+  [ -S foo.sock ] && break
+  sleep 0.2
+done
+
+[ -S foo.sock ] || fail "the server did not start listening"
+
+# The client has no foo.db of its own, only a link to the server's socket,
+# so everything it sees must come through the server.
+cd ../client || exit 1
+ln -s ../server/foo.sock foo.sock
+
+run add "first task"
+expect_status 0
+expect_out "Added task 1."
+
+# A relative batch file is resolved in the client's directory.
+printf 'add from file\n' > commands
+run batch commands
+expect_status 0
+
+run check 2 9
+expect_status 3
+expect_err "Not found: 9."
+
+run list
+expect_status 0
+expect_out "-   1. [ ] first task" "-   2. [x] from file"
+
+[ ! -e foo.db ] || fail "the client opened a database of its own"
+[ -e ../server/foo.db ] || fail "the server did not write its database"
+
+# Commands that read stdin are not forwarded, so they run against the
+# client's own directory.
+printf 'add local\n' | "$FOO" batch > out 2> err
+status=$?
+expect_status 0
+
+[ -e foo.db ] || fail "a stdin batch was forwarded to the server"
+
+kill $server
+wait $server
+
+[ ! -e ../server/foo.sock ] || fail "the server left its socket behind"
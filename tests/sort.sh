@@ -0,0 +1,37 @@
+#!/bin/sh
+# list --sort: title and status orderings, with ties kept in id order.
+
+. "$(dirname "$0")/lib.sh"
+
+run add pear apple pear banana apple
+expect_status 0
+
+run check 1 4
+expect_status 0
+
+run list --sort title
+expect_status 0
+expect_out "-   2. [ ] apple" "-   5. [ ] apple" "-   4. [x] banana" \
+  "-   1. [x] pear" "-   3. [ ] pear"
+
+run list --sort status
+expect_out "-   2. [ ] apple" "-   3. [ ] pear" "-   5. [ ] apple" \
+  "-   1. [x] pear" "-   4. [x] banana"
+
+run list --sort id
+expect_out "-   1. [x] pear" "-   2. [ ] apple" "-   3. [ ] pear" \
+  "-   4. [x] banana" "-   5. [ ] apple"
+
+# Filters and pages are selected by id first, then sorted.
+run list --sort title --pending
+expect_out "-   2. [ ] apple" "-   5. [ ] apple" "-   3. [ ] pear"
+
+run list --sort title --limit 3
+expect_out "-   2. [ ] apple" "-   1. [x] pear" "-   3. [ ] pear"
+
+run list --sort status --after 1 --limit 3
+expect_out "-   2. [ ] apple" "-   3. [ ] pear" "-   4. [x] banana"
+
+run list --sort bogus
+expect_status 2
+expect_err "Invalid value for '--sort'."